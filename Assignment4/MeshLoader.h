@@ -7,6 +7,9 @@
 #include <sstream>
 #include <iostream>
 #include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
 
 // Structure for storing vertex data.
 // We'll store: position (x, y, z), normal (nx, ny, nz), and texture coords (u, v).
@@ -29,11 +32,180 @@ struct TriData {
     TriData(int a, int b, int c) : v1(a), v2(b), v3(c) {}
 };
 
-// Inline function to read a PLY file with the assumption that
-// each line has x, y, z, nx, ny, nz, u, v in that order, and faces are triangles.
+// Scalar types a PLY property can have, under either of their header names.
+enum PLYType {
+    PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+    PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID
+};
+
+inline PLYType plyTypeFromName(const std::string &name)
+{
+    if (name == "char"   || name == "int8")    return PLY_INT8;
+    if (name == "uchar"  || name == "uint8")   return PLY_UINT8;
+    if (name == "short"  || name == "int16")   return PLY_INT16;
+    if (name == "ushort" || name == "uint16")  return PLY_UINT16;
+    if (name == "int"    || name == "int32")   return PLY_INT32;
+    if (name == "uint"   || name == "uint32")  return PLY_UINT32;
+    if (name == "float"  || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_INVALID;
+}
+
+// Size in bytes of one value of the type in a binary file.
+inline size_t plyTypeSize(PLYType type)
+{
+    static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+    return sizes[type];
+}
+
+// Decodes the binary value at p, reversing its bytes first if swap is set
+// (the file's byte order differs from the machine's).
+inline double readPLYValue(const unsigned char *p, PLYType type, bool swap)
+{
+    unsigned char b[8];
+    size_t n = plyTypeSize(type);
+    for (size_t i = 0; i < n; i++)
+        b[i] = swap ? p[n - 1 - i] : p[i];
+
+    switch (type) {
+    case PLY_INT8:    { int8_t v;   std::memcpy(&v, b, 1); return v; }
+    case PLY_UINT8:   { uint8_t v;  std::memcpy(&v, b, 1); return v; }
+    case PLY_INT16:   { int16_t v;  std::memcpy(&v, b, 2); return v; }
+    case PLY_UINT16:  { uint16_t v; std::memcpy(&v, b, 2); return v; }
+    case PLY_INT32:   { int32_t v;  std::memcpy(&v, b, 4); return v; }
+    case PLY_UINT32:  { uint32_t v; std::memcpy(&v, b, 4); return v; }
+    case PLY_FLOAT32: { float v;    std::memcpy(&v, b, 4); return v; }
+    case PLY_FLOAT64: { double v;   std::memcpy(&v, b, 8); return v; }
+    default:          return 0;
+    }
+}
+
+// One "property" line of the header. Lists store a count of countType
+// followed by that many values of type.
+struct PLYProperty {
+    std::string name;
+    PLYType type;
+    bool isList;
+    PLYType countType;
+};
+
+// One "element" line of the header and the properties listed under it.
+struct PLYElement {
+    std::string name;
+    int count;
+    std::vector<PLYProperty> properties;
+};
+
+// The VertexData field a vertex property is stored in, or null for
+// properties we don't keep (colors, etc.).
+inline float VertexData::*vertexField(const std::string &name)
+{
+    if (name == "x")  return &VertexData::x;
+    if (name == "y")  return &VertexData::y;
+    if (name == "z")  return &VertexData::z;
+    if (name == "nx") return &VertexData::nx;
+    if (name == "ny") return &VertexData::ny;
+    if (name == "nz") return &VertexData::nz;
+    if (name == "u" || name == "s") return &VertexData::u;
+    if (name == "v" || name == "t") return &VertexData::v;
+    return 0;
+}
+
+// Walks the binary data of a PLY file, checking every read against its end.
+struct PLYCursor {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool swap;
+
+    bool read(PLYType type, double &value)
+    {
+        size_t n = plyTypeSize(type);
+        if ((size_t)(end - p) < n) return false;
+        value = readPLYValue(p, type, swap);
+        p += n;
+        return true;
+    }
+    // Skips one property, list or not
+    bool skip(const PLYProperty &prop)
+    {
+        double count = 1;
+        if (prop.isList && !read(prop.countType, count)) return false;
+        size_t n = (size_t)count * plyTypeSize(prop.type);
+        if ((size_t)(end - p) < n) return false;
+        p += n;
+        return true;
+    }
+};
+
+// Binary vertex block: every vertex has the same size, so each kept property
+// is decoded from its precomputed offset straight into VertexData.
+inline bool readPLYBinaryVertices(PLYCursor &in, const PLYElement &element,
+                                  std::vector<VertexData> &vertices)
+{
+    struct Field { size_t offset; PLYType type; float VertexData::*target; };
+    std::vector<Field> plan;
+    size_t stride = 0;
+    for (size_t p = 0; p < element.properties.size(); p++) {
+        const PLYProperty &prop = element.properties[p];
+        if (prop.isList) {
+            std::cerr << "Error: List property '" << prop.name << "' in vertex element is not supported.\n";
+            return false;
+        }
+        float VertexData::*target = vertexField(prop.name);
+        if (target) {
+            Field f = {stride, prop.type, target};
+            plan.push_back(f);
+        }
+        stride += plyTypeSize(prop.type);
+    }
+
+    size_t count = vertices.size();
+    if ((size_t)(in.end - in.p) < count * stride) {
+        std::cerr << "Error: Unexpected EOF while reading vertices.\n";
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char *src = in.p + i * stride;
+        VertexData &v = vertices[i];
+        for (size_t f = 0; f < plan.size(); f++)
+            v.*plan[f].target = (float)readPLYValue(src + plan[f].offset, plan[f].type, in.swap);
+    }
+    in.p += count * stride;
+    return true;
+}
+
+// Checks that a face has three in-range vertex indices.
+inline bool checkPLYFace(int i, double vertexPerFace, const int idx[3], int vertexCount,
+                         const std::string &filename)
+{
+    if (vertexPerFace != 3) {
+        std::cerr << "Error: Face " << i << " is not a triangle (vertex count = "
+                  << vertexPerFace << ").\n";
+        return false;
+    }
+    for (int c = 0; c < 3; c++) {
+        if (idx[c] < 0 || idx[c] >= vertexCount) {
+            std::cerr << "Error: Face " << i << " has invalid indices ("
+                      << idx[0] << ", " << idx[1] << ", " << idx[2] << ") in "
+                      << filename << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool isFaceIndexList(const PLYProperty &prop)
+{
+    return prop.isList && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+}
+
+// Reads a PLY file of triangles whose vertices carry any of x, y, z, nx, ny,
+// nz, u, v (other properties and elements are skipped). Handles the ascii,
+// binary_little_endian and binary_big_endian formats with the property types
+// given in the header.
 inline bool readPLYFile(const std::string &filename, std::vector<VertexData> &vertices,std::vector<TriData> &faces)
 {
-    std::ifstream file(filename.c_str());
+    std::ifstream file(filename.c_str(), std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Error: Unable to open PLY file: " << filename << std::endl;
         return false;
@@ -41,62 +213,62 @@ inline bool readPLYFile(const std::string &filename, std::vector<VertexData> &ve
 
     std::string line;
     bool headerEnded = false;
+    std::string format = "ascii";
+    std::vector<PLYElement> elements;
     int vertexCount = 0;
     int faceCount   = 0;
 
-    // We'll keep track of the property names in the order they appear:
-    std::vector<std::string> propertyNames;
-    // Also track how many properties per vertex line we expect to read:
-    int vertexProperties = 0;
-
     // =============== 1) READ HEADER ===============
-    while (std::getline(file, line))
+    while (!headerEnded && std::getline(file, line))
     {
-        // If we already found "end_header", break:
-        if (headerEnded) break;
-
         std::istringstream iss(line);
         std::string token;
         iss >> token;
 
         if (token == "format")
         {
-            // e.g. "format ascii 1.0"
-            // We can parse it, but let's just skip for now
+            // e.g. "format ascii 1.0" or "format binary_little_endian 1.0"
+            iss >> format;
         }
         else if (token == "element")
         {
             // e.g. "element vertex 168" or "element face 189"
-            std::string which;
-            int count;
-            iss >> which >> count;
-            if (which == "vertex")
-            {
-                vertexCount = count;
-            }
-            else if (which == "face")
-            {
-                faceCount = count;
-            }
+            PLYElement element;
+            element.count = 0;
+            iss >> element.name >> element.count;
+            if (element.name == "vertex") vertexCount = element.count;
+            else if (element.name == "face") faceCount = element.count;
+            elements.push_back(element);
         }
         else if (token == "property")
         {
-            // e.g. "property float x"
-            // or    "property float nx"
-            // or    "property float u"
-            // or    "property uchar red" etc.
-            // We'll read the next two tokens: type and name
-            std::string ptype, pname;
-            iss >> ptype >> pname;
-            // We only store the *name* (e.g. "x","y","z","nx","ny","nz","u","v","red","green","blue"...)
-            // The user can adapt for r/g/b or red/green/blue as needed.
-            propertyNames.push_back(pname);
-            vertexProperties++;
+            // e.g. "property float x" or "property list uchar uint vertex_indices";
+            // it belongs to the element declared last
+            if (elements.empty()) {
+                std::cerr << "Error: Property before any element in " << filename << std::endl;
+                return false;
+            }
+            PLYProperty prop;
+            std::string ptype;
+            iss >> ptype;
+            prop.isList = ptype == "list";
+            prop.countType = PLY_INVALID;
+            if (prop.isList) {
+                std::string countType;
+                iss >> countType >> ptype;
+                prop.countType = plyTypeFromName(countType);
+            }
+            prop.type = plyTypeFromName(ptype);
+            iss >> prop.name;
+            if (prop.type == PLY_INVALID || (prop.isList && prop.countType == PLY_INVALID)) {
+                std::cerr << "Error: Unknown type in '" << line << "' in " << filename << std::endl;
+                return false;
+            }
+            elements.back().properties.push_back(prop);
         }
         else if (token == "end_header")
         {
             headerEnded = true;
-            // we can break here, or let the while loop do it
         }
         // else: other header lines (comment, obj_info, etc.) – ignore them
     }
@@ -106,96 +278,136 @@ inline bool readPLYFile(const std::string &filename, std::vector<VertexData> &ve
                   << filename << std::endl;
         return false;
     }
+    bool binary = format == "binary_little_endian" || format == "binary_big_endian";
+    if (!binary && format != "ascii") {
+        std::cerr << "Error: Unknown PLY format '" << format << "' in " << filename << std::endl;
+        return false;
+    }
 
-    // =============== 2) READ VERTEX DATA ===============
     if (vertexCount <= 0) {
         std::cerr << "Warning: No vertices in " << filename << std::endl;
     }
-    vertices.resize(vertexCount);
-
-    // For each vertex line, read exactly vertexProperties floats
-    for (int i = 0; i < vertexCount; i++)
-    {
-        if (!std::getline(file, line)) {
-            std::cerr << "Error: Unexpected EOF while reading vertices.\n";
-            return false;
-        }
-        std::istringstream iss(line);
-
-        VertexData v; // default constructed
-        // We'll read each float, store in the correct field if recognized:
-        for (int p = 0; p < vertexProperties; p++)
-        {
-            float tmp;
-            if (!(iss >> tmp)) {
-                std::cerr << "Error: Could not read property #" << p
-                          << " for vertex " << i << std::endl;
-                return false;
-            }
-            // propertyNames[p] tells us which property it is
-            const std::string &pname = propertyNames[p];
-            if      (pname == "x")    v.x  = tmp;
-            else if (pname == "y")    v.y  = tmp;
-            else if (pname == "z")    v.z  = tmp;
-            else if (pname == "nx")   v.nx = tmp;
-            else if (pname == "ny")   v.ny = tmp;
-            else if (pname == "nz")   v.nz = tmp;
-            else if (pname == "u")    v.u  = tmp;
-            else if (pname == "v")    v.v  = tmp;
-            // If your PLY uses "red green blue" or "r g b", do e.g.:
-            //else if (pname == "red"   || pname == "r") v.r = tmp;
-            //else if (pname == "green" || pname == "g") v.g = tmp;
-            //else if (pname == "blue"  || pname == "b") v.b = tmp;
-            // else if (pname == "alpha") ... etc.
-            // If there's a property we don't care about, we simply do nothing
-            // and skip it.
-        }
-
-        vertices[i] = v;
-    }
-
-    // =============== 3) READ FACE DATA ===============
     if (faceCount <= 0) {
         std::cerr << "Warning: No faces in " << filename << std::endl;
     }
-    faces.resize(faceCount);
+    vertices.assign(vertexCount > 0 ? vertexCount : 0, VertexData());
+    faces.assign(faceCount > 0 ? faceCount : 0, TriData());
 
-    for (int i = 0; i < faceCount; i++) {
-        if (!std::getline(file, line)) {
-            std::cerr << "Error: Unexpected EOF while reading faces.\n";
-            return false;
-        }
-        std::istringstream iss(line);
-        int vertexPerFace;
-        if (!(iss >> vertexPerFace)) {
-            std::cerr << "Error: Could not read 'vertex count' for face " << i << std::endl;
-            return false;
-        }
-        if (vertexPerFace != 3) {
-            std::cerr << "Error: Face " << i << " is not a triangle (vertex count = "
-                      << vertexPerFace << ").\n";
+    if (binary) {
+        // =============== 2) READ BINARY BODY ===============
+        // The rest of the file is read in one go and decoded from memory
+        std::streampos bodyStart = file.tellg();
+        file.seekg(0, std::ios::end);
+        size_t bodySize = (size_t)(file.tellg() - bodyStart);
+        file.seekg(bodyStart);
+        std::vector<unsigned char> body(bodySize);
+        if (bodySize > 0 && !file.read((char *)&body[0], bodySize)) {
+            std::cerr << "Error: Could not read the body of " << filename << std::endl;
             return false;
         }
-        int idx1, idx2, idx3;
-        if (!(iss >> idx1 >> idx2 >> idx3)) {
-            std::cerr << "Error: Could not read indices for face " << i << std::endl;
-            return false;
+
+        const uint16_t one = 1;
+        bool hostLittle = *(const unsigned char *)&one == 1;
+        PLYCursor in;
+        in.p = body.empty() ? 0 : &body[0];
+        in.end = in.p + bodySize;
+        in.swap = (format == "binary_little_endian") != hostLittle;
+
+        for (size_t e = 0; e < elements.size(); e++) {
+            const PLYElement &element = elements[e];
+            if (element.name == "vertex") {
+                if (!readPLYBinaryVertices(in, element, vertices))
+                    return false;
+                continue;
+            }
+            for (int i = 0; i < element.count; i++) {
+                for (size_t p = 0; p < element.properties.size(); p++) {
+                    const PLYProperty &prop = element.properties[p];
+                    if (element.name == "face" && isFaceIndexList(prop)) {
+                        double vertexPerFace, value = 0;
+                        int idx[3] = {0, 0, 0};
+                        bool ok = in.read(prop.countType, vertexPerFace);
+                        for (int c = 0; ok && c < 3 && c < vertexPerFace; c++) {
+                            ok = in.read(prop.type, value);
+                            idx[c] = (int)value;
+                        }
+                        if (!ok) {
+                            std::cerr << "Error: Unexpected EOF while reading faces.\n";
+                            return false;
+                        }
+                        if (!checkPLYFace(i, vertexPerFace, idx, vertexCount, filename))
+                            return false;
+                        faces[i] = TriData(idx[0], idx[1], idx[2]);
+                    } else if (!in.skip(prop)) {
+                        std::cerr << "Error: Unexpected EOF while reading " << element.name << " data.\n";
+                        return false;
+                    }
+                }
+            }
         }
-        // basic bounds check
-        if (idx1 < 0 || idx1 >= vertexCount ||
-            idx2 < 0 || idx2 >= vertexCount ||
-            idx3 < 0 || idx3 >= vertexCount) {
-            std::cerr << "Error: Face " << i << " has invalid indices ("
-                      << idx1 << ", " << idx2 << ", " << idx3 << ") in "
-                      << filename << std::endl;
-            return false;
+    } else {
+        // =============== 2) READ ASCII BODY ===============
+        // One line per element item, values in header order
+        for (size_t e = 0; e < elements.size(); e++) {
+            const PLYElement &element = elements[e];
+            std::vector<float VertexData::*> targets;
+            for (size_t p = 0; p < element.properties.size(); p++)
+                targets.push_back(element.name == "vertex" ? vertexField(element.properties[p].name) : 0);
+
+            for (int i = 0; i < element.count; i++) {
+                if (!std::getline(file, line)) {
+                    std::cerr << "Error: Unexpected EOF while reading " << element.name << " data.\n";
+                    return false;
+                }
+                const char *cur = line.c_str();
+                char *next;
+                if (element.name == "vertex") {
+                    VertexData &v = vertices[i];
+                    for (size_t p = 0; p < targets.size(); p++) {
+                        float tmp = std::strtof(cur, &next);
+                        if (next == cur) {
+                            std::cerr << "Error: Could not read property #" << p
+                                      << " for vertex " << i << std::endl;
+                            return false;
+                        }
+                        cur = next;
+                        if (targets[p]) v.*targets[p] = tmp;
+                    }
+                } else if (element.name == "face") {
+                    for (size_t p = 0; p < element.properties.size(); p++) {
+                        const PLYProperty &prop = element.properties[p];
+                        double count = prop.isList ? std::strtod(cur, &next) : 1;
+                        if (prop.isList) {
+                            if (next == cur) {
+                                std::cerr << "Error: Could not read 'vertex count' for face " << i << std::endl;
+                                return false;
+                            }
+                            cur = next;
+                        }
+                        int idx[3] = {0, 0, 0};
+                        for (int c = 0; c < (int)count; c++) {
+                            double value = std::strtod(cur, &next);
+                            if (next == cur) {
+                                std::cerr << "Error: Could not read indices for face " << i << std::endl;
+                                return false;
+                            }
+                            cur = next;
+                            if (c < 3) idx[c] = (int)value;
+                        }
+                        if (isFaceIndexList(prop)) {
+                            if (!checkPLYFace(i, count, idx, vertexCount, filename))
+                                return false;
+                            faces[i] = TriData(idx[0], idx[1], idx[2]);
+                        }
+                    }
+                }
+            }
         }
-        faces[i] = TriData(idx1, idx2, idx3);
     }
 
     file.close();
 
-    // =============== 4) PRINT RESULTS ===============
+    // =============== 3) PRINT RESULTS ===============
     std::cout << "Loaded " << vertexCount << " vertices and " << faceCount
               << " faces from " << filename << ".\n";
     if (!vertices.empty()) {
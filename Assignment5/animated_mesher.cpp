@@ -0,0 +1,124 @@
+#include "animated_mesher.h"
+#include "marching_cubes.h"
+#include "compute_normals.h"
+#include <algorithm>
+#include <cstddef>
+
+AnimatedMesher::AnimatedMesher(TimeField field, float isovalue, float min, float max, float stepsize,
+                               int bufferCount, int numThreads)
+    : field(field), isovalue(isovalue), min(min), max(max), stepsize(stepsize), numThreads(numThreads),
+      start(std::chrono::steady_clock::now()), front(-1), time(0.0f), frameCount(0), meshCount(0),
+      dropped(0), hasReady(false), stopping(false) {
+    int n = std::min(std::max(bufferCount, 2), 3);
+    vaos.resize(n);
+    vbos.resize(n);
+    ebos.resize(n);
+    indexCounts.assign(n, 0);
+    glGenVertexArrays(n, vaos.data());
+    glGenBuffers(n, vbos.data());
+    glGenBuffers(n, ebos.data());
+    for (int i = 0; i < n; ++i) {
+        glBindVertexArray(vaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, nx));
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebos[i]);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    worker = std::thread(&AnimatedMesher::workerLoop, this);
+}
+
+AnimatedMesher::~AnimatedMesher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taken.notify_all();
+    worker.join();
+    glDeleteBuffers((GLsizei)vbos.size(), vbos.data());
+    glDeleteBuffers((GLsizei)ebos.size(), ebos.data());
+    glDeleteVertexArrays((GLsizei)vaos.size(), vaos.data());
+}
+
+// Meshes the field at the current time, then waits until the render loop has
+// taken that mesh before starting the next, so no finished mesh is thrown away.
+void AnimatedMesher::workerLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taken.wait(lock, [this] { return stopping || !hasReady; });
+            if (stopping)
+                return;
+        }
+
+        FrameMesh mesh;
+        mesh.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        TimeField f = field;
+        float t = mesh.time;
+        IndexedMesh surface = marching_cubes_indexed([f, t](float x, float y, float z) { return f(x, y, z, t); },
+                                                     isovalue, min, max, stepsize, numThreads);
+        std::vector<float> normals = compute_vertex_normals(surface.vertices, surface.indices, numThreads);
+        mesh.vertices.resize(surface.vertices.size() / 3);
+        for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+            Vertex& v = mesh.vertices[i];
+            v.x = surface.vertices[i * 3 + 0];
+            v.y = surface.vertices[i * 3 + 1];
+            v.z = surface.vertices[i * 3 + 2];
+            v.nx = normals[i * 3 + 0];
+            v.ny = normals[i * 3 + 1];
+            v.nz = normals[i * 3 + 2];
+        }
+        mesh.indices.swap(surface.indices);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = std::move(mesh);
+        hasReady = true;
+    }
+}
+
+void AnimatedMesher::update() {
+    FrameMesh mesh;
+    bool fresh = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (hasReady) {
+            mesh = std::move(ready);
+            hasReady = false;
+            fresh = true;
+        }
+    }
+    ++frameCount;
+    if (!fresh) {
+        // Nothing new yet: the previous mesh is shown again
+        if (front >= 0)
+            ++dropped;
+        return;
+    }
+    taken.notify_one();
+
+    // Upload into the set after the one on screen, which the GPU is not reading
+    int next = (front + 1) % (int)vbos.size();
+    glBindBuffer(GL_ARRAY_BUFFER, vbos[next]);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebos[next]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    indexCounts[next] = (GLsizei)mesh.indices.size();
+    front = next;
+    time = mesh.time;
+    ++meshCount;
+}
+
+void AnimatedMesher::draw() const {
+    if (front < 0 || indexCounts[front] == 0)
+        return;
+    glBindVertexArray(vaos[front]);
+    glDrawElements(GL_TRIANGLES, indexCounts[front], GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,73 @@
+#ifndef ANIMATED_MESHER_H
+#define ANIMATED_MESHER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <GL/glew.h>
+#include "write_ply.h" // Vertex
+
+// A time-varying scalar field f(x, y, z, t), t in seconds.
+typedef float (*TimeField)(float x, float y, float z, float t);
+
+// Animates the isosurface of a time-varying field over [min, max]^3. A worker
+// thread keeps meshing the field at the current time (marching_cubes_indexed
+// plus smooth normals) while the render loop draws the last finished mesh.
+// Finished meshes are uploaded round-robin into bufferCount (2 or 3) sets of
+// VBO/EBO, so the upload never writes the buffer the GPU is still drawing from.
+// update() never waits for the worker: a frame for which no new mesh was ready
+// shows the previous one again and is counted as a dropped frame.
+class AnimatedMesher {
+public:
+    AnimatedMesher(TimeField field, float isovalue, float min, float max, float stepsize,
+                   int bufferCount, int numThreads);
+    // Stops the worker and deletes the GL buffers; needs the GL context.
+    ~AnimatedMesher();
+
+    // Uploads the newest finished mesh, if any, and lets the worker start the next.
+    void update();
+    // Draws the current mesh with the currently bound shader.
+    void draw() const;
+
+    size_t frames() const { return frameCount; }
+    size_t meshesShown() const { return meshCount; }
+    size_t droppedFrames() const { return dropped; }
+    // Field time of the mesh on screen
+    float shownTime() const { return time; }
+
+private:
+    struct FrameMesh {
+        float time;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    AnimatedMesher(const AnimatedMesher&);
+    AnimatedMesher& operator=(const AnimatedMesher&);
+
+    void workerLoop();
+
+    TimeField field;
+    float isovalue, min, max, stepsize;
+    int numThreads;
+    std::chrono::steady_clock::time_point start;
+
+    // GL thread only
+    std::vector<GLuint> vaos, vbos, ebos;
+    std::vector<GLsizei> indexCounts;
+    int front;                 // buffer set drawn, -1 before the first mesh
+    float time;
+    size_t frameCount, meshCount, dropped;
+
+    // Shared with the worker, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable taken;
+    FrameMesh ready;
+    bool hasReady, stopping;
+    std::thread worker;
+};
+
+#endif // ANIMATED_MESHER_H
@@ -206,7 +206,7 @@ std::vector<float> marching_cubes(float (*f)(float, float, float), float isovalu
                 if (values[7] < isovalue) cubeIndex |= 128;
 
                 // Use the lookup table to determine the vertices and generate triangles
-                int* edgeTable = marching_cubes_lut[cubeIndex];
+                const int8_t* edgeTable = mcTriangles[cubeIndex];
                 if (edgeTable[0] == -1) continue;  // No triangles for this configuration
 
                 for (int i = 0; edgeTable[i] != -1; i += 3) {
@@ -0,0 +1,371 @@
+// Standalone (GL-free) timing of the marching cubes field sampling paths.
+// Usage: mc_benchmark [stepsize] [threads]
+//        mc_benchmark --json [file]   (regression suite, JSON to file or stdout)
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <atomic>
+#include <thread>
+#include <sys/resource.h>
+
+#include "marching_cubes.h"
+#include "fields.h"
+#include "compute_normals.h"
+#include "write_ply.h"
+#include "decimate.h"
+#include "octahedral.h"
+#include "ply_ostream.h"
+
+struct FieldCase {
+    const char* name;
+    float (*f)(float, float, float);
+    BatchField batch;
+    float isovalue;
+    float lipschitz;  // bound on |grad f| over [-5, 5]^3, for marching_cubes_sparse
+};
+
+// The fields every mode runs over: the analytic fields of assignment5.cpp
+// (custom_function2, custom_function, example_function, torus_function).
+static const FieldCase fieldCases[] = {
+    {"myFunction1", myFunction1, myFunction1_batch, -1.5f, 18.0f},
+    {"myFunction2", myFunction2, myFunction2_batch, 0.0f, 1.5f},
+    {"sphere", sphere_function, sphere_function_batch, 0.0f, 18.0f},
+    {"torus", torus_function, torus_function_batch, 0.0f, 16.0f},
+};
+
+// Runs fn `repeats` times and returns the best wall time in seconds.
+template <typename Fn>
+static double best_time(int repeats, Fn fn) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        double dt = std::chrono::duration<double>(t1 - t0).count();
+        if (dt < best) best = dt;
+    }
+    return best;
+}
+
+// Writes mesh through the viewer's indexed PLY path and returns the file size in bytes.
+static long ply_size(const IndexedMesh& mesh, const char* fileName) {
+    writePLY(mesh.vertices, compute_vertex_normals(mesh.vertices, mesh.indices), mesh.indices, fileName);
+    std::ifstream in(fileName, std::ios::binary | std::ios::ate);
+    long size = (long)in.tellg();
+    in.close();
+    std::remove(fileName);
+    return size;
+}
+
+// Contents of fileName, which is then deleted.
+static std::string take_file(const char* fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::remove(fileName);
+    return contents;
+}
+
+// Peak resident set size of the process so far, in KiB.
+static long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;         // KiB on Linux
+#endif
+}
+
+// One timing configuration: the fields over [-5, 5]^3 at stepsize, on threads,
+// each stage timed as the best of repeats runs.
+struct Bench {
+    float stepsize;
+    int threads;
+    int repeats;
+};
+
+static const float min_bound = -5.0f, max_bound = 5.0f;
+
+// Prints one table row: the two times and the speedup of the second over the
+// first, then note (empty or "  (...)").
+static void print_row(const char* field, const char* stage, double before, double after, const std::string& note) {
+    std::cout << std::left << std::setw(14) << field << std::setw(12) << stage
+              << std::right << std::setw(12) << before << std::setw(12) << after
+              << std::setw(9) << std::setprecision(2) << before / after << "x"
+              << note << "\n" << std::setprecision(4);
+}
+
+// A stream for row notes, formatting numbers like the table does
+static std::ostringstream note_stream() {
+    std::ostringstream note;
+    note << std::fixed << std::setprecision(4) << "  (";
+    return note;
+}
+
+// Extraction through the function-pointer path, shared by the table and the suite
+static double time_pointer_extract(const FieldCase& c, const Bench& b, std::vector<float>& vertices) {
+    return best_time(b.repeats, [&] {
+        vertices = marching_cubes(c.f, c.isovalue, min_bound, max_bound, b.stepsize, b.threads);
+    });
+}
+
+// Sampling only: one field evaluation per lattice point
+static void sample_row(const FieldCase& c, const Bench& b) {
+    double pointer = best_time(b.repeats, [&] { sample_grid(c.f, min_bound, max_bound, b.stepsize, b.threads); });
+    double batch = best_time(b.repeats, [&] { sample_grid(c.batch, min_bound, max_bound, b.stepsize, b.threads); });
+    print_row(c.name, "sample", pointer, batch, "");
+}
+
+// Full extraction with the rolling slice cache. Returns the batched time.
+static double extract_row(const FieldCase& c, const Bench& b) {
+    std::vector<float> pointerMesh, batchMesh;
+    double pointer = time_pointer_extract(c, b, pointerMesh);
+    double batch = best_time(b.repeats, [&] {
+        batchMesh = marching_cubes(c.batch, c.isovalue, min_bound, max_bound, b.stepsize, b.threads);
+    });
+    std::ostringstream note = note_stream();
+    note << pointerMesh.size() / 9 << " vs " << batchMesh.size() / 9 << " triangles)";
+    print_row(c.name, "extract", pointer, batch, note.str());
+    return batch;
+}
+
+// Empty-space skipping, compared against the dense batched extraction
+static void sparse_row(const FieldCase& c, const Bench& b, double dense, const ScalarGrid& lattice) {
+    size_t triangles = 0;
+    SparseStats stats;
+    double sparse = best_time(b.repeats, [&] {
+        triangles = marching_cubes_sparse(c.batch, c.isovalue, min_bound, max_bound, b.stepsize,
+                                          c.lipschitz, 8, b.threads, &stats).size() / 9;
+    });
+    std::ostringstream note = note_stream();
+    note << triangles << " triangles, " << stats.activeBlocks << "/" << stats.blocks << " blocks, "
+         << stats.fieldSamples << "/" << lattice.values.size() << " samples)";
+    print_row(c.name, "sparse", dense, sparse, note.str());
+}
+
+// Pre-sampled grid: growing per-slab vectors vs count-then-fill into one exact
+// buffer, and vs repeated queries through a min-max octree (built once)
+static void grid_rows(const FieldCase& c, const Bench& b, const ScalarGrid& lattice) {
+    double grow = best_time(b.repeats, [&] { marching_cubes(lattice, c.isovalue, b.threads); });
+
+    size_t exactTriangles = 0;
+    double exact = best_time(b.repeats, [&] {
+        exactTriangles = marching_cubes_exact(lattice, c.isovalue, b.threads).size() / 9;
+    });
+    std::ostringstream exactNote = note_stream();
+    exactNote << exactTriangles << " triangles)";
+    print_row(c.name, "grid exact", grow, exact, exactNote.str());
+
+    MinMaxIndex index;
+    double build = best_time(1, [&] { index = build_minmax_index(lattice, 8, b.threads); });
+    size_t indexTriangles = 0;
+    double indexed = best_time(b.repeats, [&] {
+        indexTriangles = marching_cubes(lattice, index, c.isovalue, b.threads).size() / 9;
+    });
+    std::ostringstream indexNote = note_stream();
+    indexNote << indexTriangles << " triangles, index built in " << build << "s)";
+    print_row(c.name, "grid minmax", grow, indexed, indexNote.str());
+}
+
+// Vertex normals: a separate pass over the welded mesh vs gradients taken during extraction
+static void normals_row(const FieldCase& c, const Bench& b, const ScalarGrid& lattice) {
+    double twoPass = best_time(b.repeats, [&] {
+        IndexedMesh mesh = marching_cubes_indexed(lattice, c.isovalue, b.threads);
+        compute_vertex_normals(mesh.vertices, mesh.indices, b.threads);
+    });
+    double onePass = best_time(b.repeats, [&] { marching_cubes_indexed_normals(lattice, c.isovalue, b.threads); });
+    print_row(c.name, "normals", twoPass, onePass, "");
+}
+
+// Smooth vertex normals of the welded mesh: serial vs per-thread accumulation
+static void smooth_row(const FieldCase& c, const Bench& b, const IndexedMesh& cubes) {
+    double serial = best_time(b.repeats, [&] { compute_vertex_normals(cubes.vertices, cubes.indices); });
+    double threaded = best_time(b.repeats, [&] { compute_vertex_normals(cubes.vertices, cubes.indices, b.threads); });
+    std::ostringstream note = note_stream();
+    note << b.threads << " threads)";
+    print_row(c.name, "smooth", serial, threaded, note.str());
+}
+
+// Packing the welded mesh for upload: Vertex vs PackedVertex (octahedral normals)
+static void packed_row(const FieldCase& c, const Bench& b, const IndexedMesh& cubes, const std::vector<float>& normals) {
+    double plain = best_time(b.repeats, [&] {
+        std::vector<Vertex> mesh(cubes.vertices.size() / 3);
+        for (size_t i = 0; i < mesh.size(); ++i) {
+            Vertex& v = mesh[i];
+            v.x = cubes.vertices[i * 3 + 0];
+            v.y = cubes.vertices[i * 3 + 1];
+            v.z = cubes.vertices[i * 3 + 2];
+            v.nx = normals[i * 3 + 0];
+            v.ny = normals[i * 3 + 1];
+            v.nz = normals[i * 3 + 2];
+        }
+    });
+    double octahedral = best_time(b.repeats, [&] { pack_vertices(cubes.vertices, normals); });
+    std::ostringstream note = note_stream();
+    note << sizeof(Vertex) << " -> " << sizeof(PackedVertex) << " bytes per vertex, "
+         << cubes.vertices.size() / 3 * (sizeof(Vertex) - sizeof(PackedVertex)) / 1024 << " KB less to upload)";
+    print_row(c.name, "packed", plain, octahedral, note.str());
+}
+
+// PLY output of the welded mesh: ofstream << vs buffered ASCII vs binary
+static void ply_rows(const FieldCase& c, const Bench& b, const IndexedMesh& cubes, const std::vector<float>& normals) {
+    double old = best_time(b.repeats, [&] { write_ply_ostream(cubes, normals, "mc_benchmark_old.ply"); });
+    double ascii = best_time(b.repeats, [&] {
+        writePLY(cubes.vertices, normals, cubes.indices, "mc_benchmark_ascii.ply", PLY_ASCII);
+    });
+    double binary = best_time(b.repeats, [&] {
+        writePLY(cubes.vertices, normals, cubes.indices, "mc_benchmark_binary.ply", PLY_BINARY);
+    });
+    std::remove("mc_benchmark_old.ply");
+
+    std::ostringstream asciiNote = note_stream();
+    asciiNote << take_file("mc_benchmark_ascii.ply").size() / 1024 << " KB)";
+    print_row(c.name, "ply ascii", old, ascii, asciiNote.str());
+    std::ostringstream binaryNote = note_stream();
+    binaryNote << take_file("mc_benchmark_binary.ply").size() / 1024 << " KB)";
+    print_row(c.name, "ply binary", old, binary, binaryNote.str());
+}
+
+// Face normals of the flat soup: scalar loop vs SIMD kernel
+static void faces_row(const FieldCase& c, const Bench& b, const ScalarGrid& lattice) {
+    std::vector<float> soup = marching_cubes(lattice, c.isovalue, b.threads);
+    size_t triangles = soup.size() / 9;
+    std::vector<float> normals(soup.size());
+    double scalar = best_time(b.repeats, [&] { compute_normals_scalar(soup.data(), triangles, normals.data()); });
+    double simd = best_time(b.repeats, [&] { compute_normals(soup.data(), triangles, normals.data()); });
+    print_row(c.name, "faces", scalar, simd, std::string("  (") + compute_normals_isa() + ")");
+}
+
+// Quadric decimation of the welded mesh to a tenth of its triangles, timed by decimate itself
+static void decimate_row(const FieldCase& c, const IndexedMesh& cubes) {
+    DecimateStats stats;
+    decimate(cubes, cubes.indices.size() / 3 / 10, 0.0f, &stats);
+    std::cout << std::left << std::setw(14) << c.name << std::setw(12) << "decimate"
+              << std::right << std::setw(12) << "" << std::setw(12) << "" << std::setw(10) << ""
+              << "  (" << stats.inputTriangles << " -> " << stats.outputTriangles
+              << " triangles in " << stats.seconds << "s, max error " << stats.maxError << ")\n";
+}
+
+// Welded marching cubes vs surface nets on the same grid, and nets at twice the step
+static void nets_row(const FieldCase& c, const Bench& b, const ScalarGrid& lattice) {
+    IndexedMesh cubes, nets;
+    double cubesTime = best_time(b.repeats, [&] { cubes = marching_cubes_indexed(lattice, c.isovalue, b.threads); });
+    double netsTime = best_time(b.repeats, [&] { nets = surface_nets(lattice, c.isovalue, b.threads); });
+    size_t coarse = surface_nets(sample_grid(c.batch, min_bound, max_bound, b.stepsize * 2, b.threads),
+                                 c.isovalue, b.threads).indices.size() / 3;
+    std::ostringstream note = note_stream();
+    note << cubes.indices.size() / 3 << " vs " << nets.indices.size() / 3 << " triangles, " << coarse
+         << " at 2x step; PLY " << ply_size(cubes, "mc_benchmark_cubes.ply") / 1024 << " vs "
+         << ply_size(nets, "mc_benchmark_nets.ply") / 1024 << " KB)";
+    print_row(c.name, "nets", cubesTime, netsTime, note.str());
+}
+
+// The manual table: one row per stage for every field
+static int run_table(const Bench& b) {
+    std::cout << "stepsize " << b.stepsize << ", threads " << b.threads
+              << ", batch kernels: " << batch_field_isa() << "\n";
+    std::cout << std::left << std::setw(14) << "field" << std::setw(12) << "stage"
+              << std::right << std::setw(12) << "pointer(s)" << std::setw(12) << "batch(s)"
+              << std::setw(10) << "speedup" << "\n";
+    std::cout << std::fixed << std::setprecision(4);
+
+    for (const FieldCase& c : fieldCases) {
+        ScalarGrid lattice = sample_grid(c.batch, min_bound, max_bound, b.stepsize, 1);
+        IndexedMesh cubes = marching_cubes_indexed(lattice, c.isovalue, b.threads);
+        std::vector<float> smooth = compute_vertex_normals(cubes.vertices, cubes.indices);
+
+        sample_row(c, b);
+        sparse_row(c, b, extract_row(c, b), lattice);
+        grid_rows(c, b, lattice);
+        normals_row(c, b, lattice);
+        smooth_row(c, b, cubes);
+        packed_row(c, b, cubes, smooth);
+        ply_rows(c, b, cubes, smooth);
+        faces_row(c, b, lattice);
+        decimate_row(c, cubes);
+        nets_row(c, b, lattice);
+    }
+    return 0;
+}
+
+// Regression suite: marching_cubes (function-pointer path) and compute_normals
+// for every field over a matrix of step sizes and thread counts. Prints one JSON
+// object with a record per run. Runs go from coarse to fine, so peak_rss_kb (the
+// process high-water mark after the run) tracks the largest run so far.
+static int run_suite(std::ostream& out) {
+    const float steps[] = {0.1f, 0.05f, 0.025f};
+    std::vector<int> threadCounts(1, 1);
+    if (resolve_thread_count(0) > 1)
+        threadCounts.push_back(resolve_thread_count(0));
+
+    out << "{\n  \"batch_isa\": \"" << batch_field_isa() << "\",\n"
+        << "  \"normals_isa\": \"" << compute_normals_isa() << "\",\n"
+        << "  \"hardware_threads\": " << resolve_thread_count(0) << ",\n"
+        << "  \"runs\": [";
+    bool first = true;
+    for (float stepsize : steps) {
+        size_t points = mc_detail::lattice_coords(min_bound, max_bound, stepsize).size();
+        size_t cells = (points - 1) * (points - 1) * (points - 1);
+        for (const FieldCase& c : fieldCases) {
+            for (int threads : threadCounts) {
+                Bench b = {stepsize, threads, 3};
+
+                // Field evaluations, counted in a separate untimed run
+                std::atomic<size_t> evaluations(0);
+                float (*f)(float, float, float) = c.f;
+                marching_cubes([f, &evaluations](float x, float y, float z) {
+                    evaluations.fetch_add(1, std::memory_order_relaxed);
+                    return f(x, y, z);
+                }, c.isovalue, min_bound, max_bound, stepsize, threads);
+
+                std::vector<float> vertices;
+                double extract = time_pointer_extract(c, b, vertices);
+                double normals = best_time(b.repeats, [&] { compute_normals(vertices); });
+                size_t triangles = vertices.size() / 9;
+
+                out << (first ? "\n" : ",\n") << std::setprecision(6)
+                    << "    {\"field\": \"" << c.name << "\", \"stepsize\": " << stepsize
+                    << ", \"threads\": " << threads << ", \"cells\": " << cells
+                    << ", \"triangles\": " << triangles << ", \"field_evaluations\": " << evaluations.load()
+                    << ", \"extract_s\": " << extract << ", \"normals_s\": " << normals
+                    << ", \"cells_per_s\": " << cells / extract << ", \"triangles_per_s\": " << triangles / extract
+                    << ", \"normals_triangles_per_s\": " << triangles / normals
+                    << ", \"peak_rss_kb\": " << peak_rss_kb() << "}";
+                first = false;
+            }
+        }
+    }
+    out << "\n  ]\n}\n";
+    return out ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--json") == 0) {
+        if (argc > 2) {
+            std::ofstream file(argv[2]);
+            if (!file) {
+                std::cerr << "Error: Unable to open file " << argv[2] << " for writing." << std::endl;
+                return 1;
+            }
+            return run_suite(file);
+        }
+        return run_suite(std::cout);
+    }
+
+    Bench b = {0.05f, 1, 3};
+    if (argc > 1) b.stepsize = atof(argv[1]);
+    if (argc > 2) b.threads = atoi(argv[2]);
+    return run_table(b);
+}
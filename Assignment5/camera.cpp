@@ -39,6 +39,15 @@ void cameraFirstPerson(GLFWwindow* window, glm::mat4& viewMatrix, float speed)
         gRadius += (speed * gZoomSpeed);
     }
     
+    glm::vec3 eye = cameraPosition();
+    glm::vec3 center(0.0f, 0.0f, 0.0f); // looking toward origin
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+    
+    viewMatrix = glm::lookAt(eye, center, up);
+}
+
+glm::vec3 cameraPosition()
+{
     // Now compute camera position in Cartesian coords from (r, theta, phi).
     // We'll assume y is "up," so let's treat phi as the angle above the x-z plane.
     
@@ -46,11 +55,7 @@ void cameraFirstPerson(GLFWwindow* window, glm::mat4& viewMatrix, float speed)
     float y = gRadius * sinf(gPhi);
     float z = gRadius * cosf(gPhi) * sinf(gTheta);
     
-    glm::vec3 eye(x, y, z);
-    glm::vec3 center(0.0f, 0.0f, 0.0f); // looking toward origin
-    glm::vec3 up(0.0f, 1.0f, 0.0f);
-    
-    viewMatrix = glm::lookAt(eye, center, up);
+    return glm::vec3(x, y, z);
 }
 
 // Called automatically by GLFW when a mouse button is pressed/released.
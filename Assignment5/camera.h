@@ -10,6 +10,9 @@
 // speed: a parameter to control camera sensitivity
 void cameraFirstPerson(GLFWwindow* window, glm::mat4& viewMatrix, float speed);
 
+// Current eye position of the spherical camera (it always looks at the origin).
+glm::vec3 cameraPosition();
+
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 
 void cursorPositionCallback(GLFWwindow* window, double xpos, double ypos);
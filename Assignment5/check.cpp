@@ -0,0 +1,188 @@
+// Standalone (GL-free) correctness checks for the fast paths that have a plain
+// reference to compare against. Prints one line per check and exits with 1 if
+// any of them fails.
+// Usage: mc_check [stepsize] [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <iterator>
+
+#include "marching_cubes.h"
+#include "fields.h"
+#include "compute_normals.h"
+#include "octahedral.h"
+#include "write_ply.h"
+#include "ply_ostream.h"
+
+struct FieldCase {
+    const char* name;
+    BatchField batch;
+    float isovalue;
+};
+
+// The benchmark's fields, at the benchmark's isovalues
+static const FieldCase fieldCases[] = {
+    {"myFunction1", myFunction1_batch, -1.5f},
+    {"myFunction2", myFunction2_batch, 0.0f},
+    {"sphere", sphere_function_batch, 0.0f},
+    {"torus", torus_function_batch, 0.0f},
+};
+
+// SIMD and scalar face normals may differ by this much per component
+static const float FACE_NORMAL_TOLERANCE = 1e-5f;
+
+// Threaded and serial smooth normals add the same terms in a different order
+static const float VERTEX_NORMAL_TOLERANCE = 1e-5f;
+
+// Octahedral normals must come back within this angle (radians), about 0.006 degrees
+static const double OCTAHEDRAL_TOLERANCE = 1e-4;
+
+// Prints the outcome of one check and returns whether it passed.
+static bool report(const char* field, const char* check, bool passed, const std::string& note) {
+    std::cout << std::left << std::setw(14) << field << std::setw(12) << check
+              << (passed ? "ok  " : "FAIL") << "  (" << note << ")\n";
+    return passed;
+}
+
+// "<measure> <value>" with the value in short scientific notation
+static std::string measured(const char* measure, double value) {
+    std::ostringstream note;
+    note << measure << " " << std::scientific << std::setprecision(1) << value;
+    return note.str();
+}
+
+// Largest component difference between two normal buffers. NaNs (from
+// degenerate triangles) must appear in the same places.
+static float max_difference(const std::vector<float>& a, const std::vector<float>& b) {
+    float worst = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::isnan(a[i]) != std::isnan(b[i]))
+            return INFINITY;
+        if (!std::isnan(a[i]))
+            worst = std::max(worst, std::fabs(a[i] - b[i]));
+    }
+    return worst;
+}
+
+// Face normals of the flat soup: the SIMD kernel against the scalar loop
+static bool check_face_normals(const FieldCase& c, const ScalarGrid& lattice) {
+    std::vector<float> soup = marching_cubes(lattice, c.isovalue, 1);
+    std::vector<float> scalarNormals(soup.size()), simdNormals(soup.size());
+    compute_normals_scalar(soup.data(), soup.size() / 9, scalarNormals.data());
+    compute_normals(soup.data(), soup.size() / 9, simdNormals.data());
+    float difference = max_difference(scalarNormals, simdNormals);
+    return report(c.name, "faces", difference <= FACE_NORMAL_TOLERANCE, measured("max difference", difference));
+}
+
+// Smooth vertex normals of the welded mesh: per-thread accumulation against the
+// serial loop. At the default step only the myFunction meshes are big enough to
+// be split; the sphere and torus stay on one thread and match exactly.
+static bool check_vertex_normals(const FieldCase& c, const ScalarGrid& lattice, int threads) {
+    IndexedMesh mesh = marching_cubes_indexed(lattice, c.isovalue, 1);
+    std::vector<float> serial = compute_vertex_normals(mesh.vertices, mesh.indices);
+    std::vector<float> threaded = compute_vertex_normals(mesh.vertices, mesh.indices, threads);
+    float difference = serial.size() == threaded.size() ? max_difference(serial, threaded) : INFINITY;
+    return report(c.name, "smooth", difference <= VERTEX_NORMAL_TOLERANCE, measured("max difference", difference));
+}
+
+// Largest angle in radians between a normal (3 floats each, zero ones skipped)
+// and its octahedral encode/decode round trip.
+static double octahedral_error(const std::vector<float>& normals) {
+    double worst = 0.0;
+    for (size_t i = 0; i + 2 < normals.size(); i += 3) {
+        const float* n = &normals[i];
+        double length = std::sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        if (length == 0.0)
+            continue;
+        int16_t e[2];
+        float d[3];
+        octahedral_encode(n, e);
+        octahedral_decode(e, d);
+        // |n x d| = sin(angle), accurate for the tiny angles involved
+        double cx = (double)n[1] * d[2] - (double)n[2] * d[1];
+        double cy = (double)n[2] * d[0] - (double)n[0] * d[2];
+        double cz = (double)n[0] * d[1] - (double)n[1] * d[0];
+        worst = std::max(worst, std::asin(std::min(1.0, std::sqrt(cx * cx + cy * cy + cz * cz) / length)));
+    }
+    return worst;
+}
+
+// Octahedral round trip over a spiral of directions covering the sphere,
+// including the poles and the folded lower half
+static bool check_octahedral_sphere() {
+    std::vector<float> directions;
+    const int spiral = 100000;
+    for (int i = 0; i < spiral; ++i) {
+        float z = 1.0f - 2.0f * (i + 0.5f) / spiral;
+        float r = std::sqrt(1.0f - z * z), angle = 2.39996323f * i;
+        directions.push_back(r * std::cos(angle));
+        directions.push_back(r * std::sin(angle));
+        directions.push_back(z);
+    }
+    float axes[] = {1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1};
+    directions.insert(directions.end(), axes, axes + 18);
+    double error = octahedral_error(directions);
+    return report("directions", "octahedral", error <= OCTAHEDRAL_TOLERANCE, measured("max angle (rad)", error));
+}
+
+// Octahedral round trip of the smooth normals of the welded mesh
+static bool check_octahedral_mesh(const FieldCase& c, const ScalarGrid& lattice) {
+    IndexedMesh mesh = marching_cubes_indexed(lattice, c.isovalue, 1);
+    double error = octahedral_error(compute_vertex_normals(mesh.vertices, mesh.indices));
+    return report(c.name, "octahedral", error <= OCTAHEDRAL_TOLERANCE, measured("max angle (rad)", error));
+}
+
+// Contents of fileName, which is then deleted.
+static std::string take_file(const char* fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::remove(fileName);
+    return contents;
+}
+
+// ASCII output of the buffered writePLY against the old ofstream writer, byte for byte
+static bool check_ascii_ply(const FieldCase& c, const ScalarGrid& lattice) {
+    IndexedMesh mesh = marching_cubes_indexed(lattice, c.isovalue, 1);
+    std::vector<float> normals = compute_vertex_normals(mesh.vertices, mesh.indices);
+    write_ply_ostream(mesh, normals, "mc_check_old.ply");
+    writePLY(mesh.vertices, normals, mesh.indices, "mc_check_ascii.ply", PLY_ASCII);
+    std::string oldFile = take_file("mc_check_old.ply");
+    std::string asciiFile = take_file("mc_check_ascii.ply");
+    if (!oldFile.empty() && oldFile == asciiFile)
+        return report(c.name, "ply ascii", true, std::to_string(asciiFile.size()) + " bytes, identical");
+    size_t common = std::min(oldFile.size(), asciiFile.size());
+    size_t mismatch = std::mismatch(oldFile.begin(), oldFile.begin() + common, asciiFile.begin()).first - oldFile.begin();
+    return report(c.name, "ply ascii", false, "first difference at byte " + std::to_string(mismatch));
+}
+
+int main(int argc, char* argv[]) {
+    float stepsize = 0.05f;
+    int threads = 4;   // fixed rather than the core count, so the threaded paths run everywhere
+    if (argc > 1) stepsize = atof(argv[1]);
+    if (argc > 2) threads = atoi(argv[2]);
+
+    std::cout << "stepsize " << stepsize << ", threads " << threads
+              << ", normals kernel: " << compute_normals_isa() << "\n";
+    int failures = !check_octahedral_sphere();
+    for (const FieldCase& c : fieldCases) {
+        ScalarGrid lattice = sample_grid(c.batch, -5.0f, 5.0f, stepsize, 0);
+        failures += !check_face_normals(c, lattice);
+        failures += !check_vertex_normals(c, lattice, threads);
+        failures += !check_octahedral_mesh(c, lattice);
+        failures += !check_ascii_ply(c, lattice);
+    }
+    if (failures > 0) {
+        std::cerr << "Error: " << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,275 @@
+#include "chunk_manager.h"
+#include "marching_cubes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Uploads per frame; each is one chunk's VBO and EBO
+static const int MAX_UPLOADS_PER_FRAME = 4;
+
+// Dead band around each level's ring boundary, in chunk widths
+static const float LOD_MARGIN = 0.5f;
+
+// Hangs a skirt of the given depth below every open edge of the mesh that lies
+// on one of the box's side faces (x or z = boxMin or boxMax). Skirt vertices
+// copy the normal of the vertex above them so the shading carries on down.
+static void add_skirts(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                       const float boxMin[3], const float boxMax[3], float depth) {
+    // Undirected edge -> number of triangles using it; open edges have one
+    std::unordered_map<uint64_t, int> edgeUse;
+    for (size_t t = 0; t < indices.size(); t += 3)
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+            ++edgeUse[(uint64_t)std::min(a, b) << 32 | std::max(a, b)];
+        }
+
+    std::unordered_map<uint32_t, uint32_t> below;  // surface vertex -> its skirt vertex
+    size_t triangleIndices = indices.size();
+    for (size_t t = 0; t < triangleIndices; t += 3)
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+            if (edgeUse[(uint64_t)std::min(a, b) << 32 | std::max(a, b)] != 1)
+                continue;
+            const Vertex& va = vertices[a];
+            const Vertex& vb = vertices[b];
+            bool onSide = (va.x == boxMin[0] && vb.x == boxMin[0]) || (va.x == boxMax[0] && vb.x == boxMax[0]) ||
+                          (va.z == boxMin[2] && vb.z == boxMin[2]) || (va.z == boxMax[2] && vb.z == boxMax[2]);
+            if (!onSide)
+                continue;
+
+            uint32_t ends[2] = {a, b};
+            uint32_t low[2];
+            for (int i = 0; i < 2; ++i) {
+                std::unordered_map<uint32_t, uint32_t>::iterator it = below.find(ends[i]);
+                if (it == below.end()) {
+                    Vertex v = vertices[ends[i]];
+                    v.y -= depth;
+                    it = below.insert(std::make_pair(ends[i], (uint32_t)vertices.size())).first;
+                    vertices.push_back(v);
+                }
+                low[i] = it->second;
+            }
+            // Wound like the triangle that would continue the surface across a -> b
+            uint32_t skirt[6] = {b, a, low[0], b, low[0], low[1]};
+            indices.insert(indices.end(), skirt, skirt + 6);
+        }
+}
+
+ChunkManager::ChunkManager(float (*field)(float, float, float), float isovalue, float chunkSize,
+                           float yMin, float yMax, float stepsize, float viewDistance, int lodLevels,
+                           size_t cacheCapacity, int numWorkers)
+    : field(field), isovalue(isovalue), chunkSize(chunkSize), yMin(yMin), yMax(yMax),
+      stepsize(stepsize), viewDistance(viewDistance), lodLevels(std::max(lodLevels, 1)),
+      cacheCapacity(cacheCapacity), visibleTriangleCount(0), stopping(false) {
+    // The coarsest step must still fit in a chunk
+    while (this->lodLevels > 1 && stepsize * (1 << (this->lodLevels - 1)) > chunkSize)
+        --this->lodLevels;
+    int n = resolve_thread_count(numWorkers);
+    for (int i = 0; i < n; ++i)
+        workers.push_back(std::thread(&ChunkManager::workerLoop, this));
+}
+
+ChunkManager::~ChunkManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    while (!cache.empty())
+        evict(cache.begin()->first);
+}
+
+void ChunkManager::workerLoop() {
+    for (;;) {
+        ChunkJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            job = queue.front();
+            queue.pop_front();
+        }
+        ChunkMesh mesh = meshChunk(job);
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(mesh));
+    }
+}
+
+int ChunkManager::levelAt(float distance) const {
+    // The column under the camera and its neighbours are always full resolution
+    if (distance <= chunkSize)
+        return 0;
+    int level = lodLevels - 1;
+    float reach = viewDistance;
+    while (level > 0 && distance <= reach * 0.5f) {
+        --level;
+        reach *= 0.5f;
+    }
+    return level;
+}
+
+// A column keeps its current level until its distance is more than the margin
+// past a ring boundary, so a camera moving along a boundary does not re-mesh
+// the columns on it over and over.
+int ChunkManager::levelAt(float distance, int current) const {
+    float margin = LOD_MARGIN * chunkSize;
+    if (current >= levelAt(distance - margin) && current <= levelAt(distance + margin))
+        return current;
+    return levelAt(distance);
+}
+
+ChunkManager::ChunkMesh ChunkManager::meshChunk(const ChunkJob& job) const {
+    const ChunkKey& key = job.key;
+    float boxMin[3] = {key.x * chunkSize, yMin, key.z * chunkSize};
+    float boxMax[3] = {(key.x + 1) * chunkSize, yMax, (key.z + 1) * chunkSize};
+    // Gradient normals only depend on the field, so neighbouring chunks shade seamlessly
+    IndexedMesh surface = marching_cubes_indexed_normals(field, nullptr, isovalue, boxMin, boxMax,
+                                                         stepsize * (1 << job.level), 1);
+    const std::vector<float>& normals = surface.normals;
+
+    ChunkMesh mesh;
+    mesh.key = key;
+    mesh.level = job.level;
+    mesh.vertices.resize(surface.vertices.size() / 3);
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        Vertex& v = mesh.vertices[i];
+        v.x = surface.vertices[i * 3 + 0];
+        v.y = surface.vertices[i * 3 + 1];
+        v.z = surface.vertices[i * 3 + 2];
+        v.nx = normals[i * 3 + 0];
+        v.ny = normals[i * 3 + 1];
+        v.nz = normals[i * 3 + 2];
+    }
+    mesh.indices.swap(surface.indices);
+    if (lodLevels > 1)
+        add_skirts(mesh.vertices, mesh.indices, boxMin, boxMax, stepsize * (1 << (lodLevels - 1)));
+    return mesh;
+}
+
+void ChunkManager::upload(ChunkMesh& mesh) {
+    if (cache.count(mesh.key))
+        evict(mesh.key);
+
+    Chunk chunk = {0, 0, 0, (GLsizei)mesh.indices.size(), mesh.level, lru.end()};
+    // Empty chunks are cached too (so they are not meshed again) but need no buffers
+    if (chunk.indexCount > 0) {
+        glGenVertexArrays(1, &chunk.vao);
+        glBindVertexArray(chunk.vao);
+
+        glGenBuffers(1, &chunk.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, nx));
+        glEnableVertexAttribArray(1);
+
+        glGenBuffers(1, &chunk.ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    lru.push_front(mesh.key);
+    chunk.lruPos = lru.begin();
+    cache[mesh.key] = chunk;
+}
+
+void ChunkManager::evict(const ChunkKey& key) {
+    std::unordered_map<ChunkKey, Chunk, ChunkKeyHash>::iterator it = cache.find(key);
+    if (it == cache.end())
+        return;
+    Chunk& chunk = it->second;
+    if (chunk.indexCount > 0) {
+        glDeleteBuffers(1, &chunk.vbo);
+        glDeleteBuffers(1, &chunk.ebo);
+        glDeleteVertexArrays(1, &chunk.vao);
+    }
+    lru.erase(chunk.lruPos);
+    cache.erase(it);
+}
+
+void ChunkManager::update(const glm::vec3& eye) {
+    // Collect what the workers finished; those keys leave pending once uploaded
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < finished.size(); ++i)
+            ready.push_back(std::move(finished[i]));
+        finished.clear();
+    }
+    std::vector<ChunkKey> uploaded;
+    for (int n = 0; n < MAX_UPLOADS_PER_FRAME && !ready.empty(); ++n) {
+        upload(ready.front());
+        uploaded.push_back(ready.front().key);
+        ready.pop_front();
+    }
+
+    // Columns whose centre is within viewDistance of the camera (in x/z)
+    int cx = (int)std::floor(eye.x / chunkSize);
+    int cz = (int)std::floor(eye.z / chunkSize);
+    int reach = (int)std::ceil(viewDistance / chunkSize) + 1;
+    std::vector<std::pair<float, ChunkJob> > missing;
+    visible.clear();
+    visibleTriangleCount = 0;
+    for (int x = cx - reach; x <= cx + reach; ++x)
+        for (int z = cz - reach; z <= cz + reach; ++z) {
+            float dx = (x + 0.5f) * chunkSize - eye.x;
+            float dz = (z + 0.5f) * chunkSize - eye.z;
+            float distance = std::sqrt(dx * dx + dz * dz);
+            if (distance > viewDistance)
+                continue;
+            ChunkJob job = {{x, z}, levelAt(distance)};
+            std::unordered_map<ChunkKey, Chunk, ChunkKeyHash>::iterator it = cache.find(job.key);
+            if (it != cache.end()) {
+                job.level = levelAt(distance, it->second.level);
+                // Mark as most recently used
+                lru.splice(lru.begin(), lru, it->second.lruPos);
+                visible.push_back(job.key);
+                visibleTriangleCount += it->second.indexCount / 3;
+                // Drawn at its old level until the re-meshed chunk replaces it
+                if (it->second.level != job.level)
+                    missing.push_back(std::make_pair(distance, job));
+            } else {
+                missing.push_back(std::make_pair(distance, job));
+            }
+        }
+    std::sort(missing.begin(), missing.end(),
+              [](const std::pair<float, ChunkJob>& a, const std::pair<float, ChunkJob>& b) { return a.first < b.first; });
+
+    // Replace the queue with the chunks missing now, nearest first; queued chunks
+    // that went out of view are dropped before anyone meshes them
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < uploaded.size(); ++i)
+            pending.erase(uploaded[i]);
+        for (size_t i = 0; i < queue.size(); ++i)
+            pending.erase(queue[i].key);
+        queue.clear();
+        for (size_t i = 0; i < missing.size(); ++i)
+            if (pending.insert(missing[i].second.key).second)
+                queue.push_back(missing[i].second);
+    }
+    wake.notify_all();
+
+    // Evict the least recently seen chunks; the ones in view were just moved to
+    // the front, so they go last
+    size_t capacity = std::max(cacheCapacity, visible.size());
+    while (cache.size() > capacity)
+        evict(lru.back());
+}
+
+void ChunkManager::draw() const {
+    for (size_t i = 0; i < visible.size(); ++i) {
+        const Chunk& chunk = cache.find(visible[i])->second;
+        if (chunk.indexCount == 0)
+            continue;
+        glBindVertexArray(chunk.vao);
+        glDrawElements(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
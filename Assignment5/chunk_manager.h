@@ -0,0 +1,112 @@
+#ifndef CHUNK_MANAGER_H
+#define CHUNK_MANAGER_H
+
+#include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "write_ply.h" // Vertex
+
+// Meshes an unbounded field as square columns of chunkSize x chunkSize (in x
+// and z) spanning [yMin, yMax], like the chunked terrain of the Unity project
+// in Problem Set/probSet8. Every frame, update() requests the columns within
+// viewDistance (horizontally) of the camera; they are meshed by
+// marching_cubes_indexed on background worker threads, and the finished meshes
+// are uploaded on the calling (GL) thread, a few per frame, so frame time does
+// not depend on how many chunks are being meshed.
+// Uploaded chunks live in an LRU cache of at most cacheCapacity entries: chunks
+// that leave the view stay cached (and reappear at once if the camera comes
+// back) until the least recently seen ones are evicted to make room.
+// With lodLevels > 1, columns further out are meshed at 2x, 4x, ... the step:
+// level l covers distances up to viewDistance / 2^(lodLevels - 1 - l), so with
+// four levels the inner eighth of the view is full resolution, the next eighth
+// half resolution, the next quarter quarter resolution and the outer half an
+// eighth; columns within one chunk width of the camera are always level 0.
+// A column only changes level once it is half a chunk width past a ring
+// boundary, so moving along a boundary does not keep re-meshing it, and it
+// keeps drawing its old mesh until the new one is uploaded.
+// Neighbouring columns of different levels do not share their boundary
+// vertices, so every column hangs a skirt of depth one coarsest step straight
+// down (-y) from its open side edges to hide the cracks, which assumes a
+// height-field-like surface such as terrain.
+class ChunkManager {
+public:
+    ChunkManager(float (*field)(float, float, float), float isovalue, float chunkSize, float yMin, float yMax,
+                 float stepsize, float viewDistance, int lodLevels, size_t cacheCapacity, int numWorkers);
+    // Stops the workers and deletes the GL buffers; needs the GL context.
+    ~ChunkManager();
+
+    // Uploads finished chunks and queues the missing ones around eye.
+    void update(const glm::vec3& eye);
+    // Draws the cached chunks in view, with the currently bound shader.
+    void draw() const;
+
+    size_t cachedChunks() const { return cache.size(); }
+    size_t visibleChunks() const { return visible.size(); }
+    size_t visibleTriangles() const { return visibleTriangleCount; }
+
+private:
+    struct ChunkKey {
+        int x, z;
+        bool operator==(const ChunkKey& o) const { return x == o.x && z == o.z; }
+    };
+    struct ChunkKeyHash {
+        size_t operator()(const ChunkKey& k) const { return (size_t)(uint32_t)k.x * 73856093u ^ (size_t)(uint32_t)k.z * 19349663u; }
+    };
+    struct ChunkJob {
+        ChunkKey key;
+        int level;
+    };
+    struct Chunk {
+        GLuint vao, vbo, ebo;
+        GLsizei indexCount;
+        int level;
+        std::list<ChunkKey>::iterator lruPos;
+    };
+    struct ChunkMesh {
+        ChunkKey key;
+        int level;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    ChunkManager(const ChunkManager&);
+    ChunkManager& operator=(const ChunkManager&);
+
+    void workerLoop();
+    ChunkMesh meshChunk(const ChunkJob& job) const;
+    int levelAt(float distance) const;
+    int levelAt(float distance, int current) const;
+    void upload(ChunkMesh& mesh);
+    void evict(const ChunkKey& key);
+
+    float (*field)(float, float, float);
+    float isovalue, chunkSize, yMin, yMax, stepsize, viewDistance;
+    int lodLevels;
+    size_t cacheCapacity;
+
+    // GL thread only
+    std::unordered_map<ChunkKey, Chunk, ChunkKeyHash> cache;
+    std::list<ChunkKey> lru;            // front = most recently in view
+    std::vector<ChunkKey> visible;      // cached chunks in view this frame
+    std::deque<ChunkMesh> ready;        // meshed, waiting for upload
+    size_t visibleTriangleCount;
+
+    // Shared with the workers, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<ChunkJob> queue;                            // nearest first
+    std::unordered_set<ChunkKey, ChunkKeyHash> pending;    // queued, meshing or awaiting upload
+    std::vector<ChunkMesh> finished;
+    bool stopping;
+    std::vector<std::thread> workers;
+};
+
+#endif // CHUNK_MANAGER_H
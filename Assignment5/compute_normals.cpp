@@ -1,25 +1,43 @@
 #include "compute_normals.h"
 #include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include "marching_cubes.h" // resolve_thread_count
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NORMALS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NORMALS_SSE2 1
+#endif
 
 // Function to compute normals for each vertex
 std::vector<float> compute_normals(const std::vector<float>& vertices) {
-    std::vector<float> normals;
+    std::vector<float> normals(vertices.size() / 9 * 9);
+    compute_normals(vertices.data(), vertices.size() / 9, normals.data());
+    return normals;
+}
 
+void compute_normals_scalar(const float* triangles, size_t count, float* normals) {
     // Iterate over each triangle (every 3 vertices)
-    for (size_t i = 0; i < vertices.size(); i += 9) {
+    for (size_t t = 0; t < count; ++t) {
+        const float* v = triangles + t * 9;
         // Get three vertices of the triangle
-        float v1x = vertices[i];
-        float v1y = vertices[i + 1];
-        float v1z = vertices[i + 2];
+        float v1x = v[0];
+        float v1y = v[1];
+        float v1z = v[2];
 
-        float v2x = vertices[i + 3];
-        float v2y = vertices[i + 4];
-        float v2z = vertices[i + 5];
+        float v2x = v[3];
+        float v2y = v[4];
+        float v2z = v[5];
 
-        float v3x = vertices[i + 6];
-        float v3y = vertices[i + 7];
-        float v3z = vertices[i + 8];
+        float v3x = v[6];
+        float v3y = v[7];
+        float v3z = v[8];
 
         // Calculate the edge vectors of the triangle
         float e1x = v2x - v1x;
@@ -42,12 +60,205 @@ std::vector<float> compute_normals(const std::vector<float>& vertices) {
         nz /= length;
 
         // Repeat the normal vector three times
+        float* n = normals + t * 9;
+        for (int j = 0; j < 3; ++j) {
+            n[j * 3] = nx;
+            n[j * 3 + 1] = ny;
+            n[j * 3 + 2] = nz;
+        }
+    }
+}
+
+#if NORMALS_AVX2 || NORMALS_SSE2
+// Writes the normals of 4 consecutive triangles (one per lane of nx, ny, nz),
+// 3 copies each. After the transpose each row is (x, y, z, 0); every 4-float
+// store spills one float into the next slot, which the next store overwrites,
+// and the last one is split so nothing is written past the 4 triangles.
+static inline void store_normals4(float* n, __m128 nx, __m128 ny, __m128 nz) {
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(nx, ny, nz, w);
+    __m128 rows[4] = {nx, ny, nz, w};
+    for (int l = 0; l < 4; ++l) {
+        float* p = n + l * 9;
+        _mm_storeu_ps(p, rows[l]);
+        _mm_storeu_ps(p + 3, rows[l]);
+        if (l < 3) {
+            _mm_storeu_ps(p + 6, rows[l]);
+        } else {
+            _mm_storel_pi((__m64*)(p + 6), rows[l]);
+            _mm_store_ss(p + 8, _mm_movehl_ps(rows[l], rows[l]));
+        }
+    }
+}
+
+#if NORMALS_AVX2
+static const int LANES = 8;
+typedef __m256 Lanes;
+// Coordinate c (0..8) of 8 consecutive triangles
+static inline Lanes column(const float* v, int c) {
+    return _mm256_i32gather_ps(v + c, _mm256_setr_epi32(0, 9, 18, 27, 36, 45, 54, 63), 4);
+}
+static inline void store_normals(float* n, Lanes nx, Lanes ny, Lanes nz) {
+    store_normals4(n, _mm256_castps256_ps128(nx), _mm256_castps256_ps128(ny), _mm256_castps256_ps128(nz));
+    store_normals4(n + 36, _mm256_extractf128_ps(nx, 1), _mm256_extractf128_ps(ny, 1), _mm256_extractf128_ps(nz, 1));
+}
+static inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+static inline Lanes splat(float v) { return _mm256_set1_ps(v); }
+static inline Lanes rsqrt(Lanes v) { return _mm256_rsqrt_ps(v); }
+#else
+static const int LANES = 4;
+typedef __m128 Lanes;
+// Coordinate c (0..8) of 4 consecutive triangles
+static inline Lanes column(const float* v, int c) {
+    return _mm_setr_ps(v[c], v[9 + c], v[18 + c], v[27 + c]);
+}
+static inline void store_normals(float* n, Lanes nx, Lanes ny, Lanes nz) { store_normals4(n, nx, ny, nz); }
+static inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes splat(float v) { return _mm_set1_ps(v); }
+static inline Lanes rsqrt(Lanes v) { return _mm_rsqrt_ps(v); }
+#endif
+
+// LANES triangles at a time: each coordinate of the triangles is gathered into
+// its own register so every lane does the same arithmetic, and the length is
+// normalized with the rsqrt estimate refined by one Newton step
+// (y * (1.5 - 0.5 * d * y * y)), which brings it to within a few ulps of
+// 1 / sqrt(d). Degenerate triangles come out NaN, as in the scalar version.
+void compute_normals(const float* triangles, size_t count, float* normals) {
+    const Lanes half = splat(0.5f), threeHalves = splat(1.5f);
+    size_t t = 0;
+    for (; t + LANES <= count; t += LANES) {
+        const float* v = triangles + t * 9;
+        Lanes v1x = column(v, 0), v1y = column(v, 1), v1z = column(v, 2);
+        Lanes e1x = sub(column(v, 3), v1x), e1y = sub(column(v, 4), v1y), e1z = sub(column(v, 5), v1z);
+        Lanes e2x = sub(column(v, 6), v1x), e2y = sub(column(v, 7), v1y), e2z = sub(column(v, 8), v1z);
+
+        Lanes nx = sub(mul(e1y, e2z), mul(e1z, e2y));
+        Lanes ny = sub(mul(e1z, e2x), mul(e1x, e2z));
+        Lanes nz = sub(mul(e1x, e2y), mul(e1y, e2x));
+
+        Lanes d = add(add(mul(nx, nx), mul(ny, ny)), mul(nz, nz));
+        Lanes y = rsqrt(d);
+        y = mul(y, sub(threeHalves, mul(mul(half, d), mul(y, y))));
+        store_normals(normals + t * 9, mul(nx, y), mul(ny, y), mul(nz, y));
+    }
+    compute_normals_scalar(triangles + t * 9, count - t, normals + t * 9);
+}
+#else
+void compute_normals(const float* triangles, size_t count, float* normals) {
+    compute_normals_scalar(triangles, count, normals);
+}
+#endif
+
+const char* compute_normals_isa() {
+#if NORMALS_AVX2
+    return "avx2";
+#elif NORMALS_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// Adds the unnormalized cross product of triangles [t0, t1) onto their three
+// vertices in sums, which holds vertex IDs from base on. Its length is twice
+// the triangle area, so larger triangles contribute more.
+static void accumulate_face_normals(const std::vector<float>& vertices, const std::vector<uint32_t>& indices,
+                                    size_t t0, size_t t1, uint32_t base, float* sums) {
+    for (size_t i = t0 * 3; i < t1 * 3; i += 3) {
+        const float* v1 = &vertices[indices[i] * 3];
+        const float* v2 = &vertices[indices[i + 1] * 3];
+        const float* v3 = &vertices[indices[i + 2] * 3];
+
+        float e1x = v2[0] - v1[0], e1y = v2[1] - v1[1], e1z = v2[2] - v1[2];
+        float e2x = v3[0] - v1[0], e2y = v3[1] - v1[1], e2z = v3[2] - v1[2];
+
+        float nx = e1y * e2z - e1z * e2y;
+        float ny = e1z * e2x - e1x * e2z;
+        float nz = e1x * e2y - e1y * e2x;
+
         for (int j = 0; j < 3; ++j) {
-            normals.push_back(nx);
-            normals.push_back(ny);
-            normals.push_back(nz);
+            float* n = &sums[(indices[i + j] - base) * 3];
+            n[0] += nx;
+            n[1] += ny;
+            n[2] += nz;
+        }
+    }
+}
+
+// Normalizes the 3-float normals [begin, end) in place, leaving zero ones as they are.
+static void normalize_normals(float* begin, float* end) {
+    for (float* n = begin; n < end; n += 3) {
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
         }
     }
+}
 
+// Function to compute smooth normals for a mesh with shared vertices
+std::vector<float> compute_vertex_normals(const std::vector<float>& vertices, const std::vector<uint32_t>& indices) {
+    std::vector<float> normals(vertices.size(), 0.0f);
+    accumulate_face_normals(vertices, indices, 0, indices.size() / 3, 0, normals.data());
+    normalize_normals(normals.data(), normals.data() + normals.size());
+    return normals;
+}
+
+// Smaller meshes are not worth starting threads for
+static const size_t MIN_TRIANGLES_PER_THREAD = 1 << 15;
+
+// Runs job(s) for s in [0, n) on n threads.
+static void run_threads(int n, const std::function<void(int)>& job) {
+    std::vector<std::thread> workers;
+    for (int s = 0; s < n; ++s)
+        workers.push_back(std::thread(job, s));
+    for (size_t s = 0; s < workers.size(); ++s)
+        workers[s].join();
+}
+
+std::vector<float> compute_vertex_normals(const std::vector<float>& vertices, const std::vector<uint32_t>& indices,
+                                          int numThreads) {
+    size_t triangles = indices.size() / 3;
+    size_t threads = std::min((size_t)resolve_thread_count(numThreads), triangles / MIN_TRIANGLES_PER_THREAD);
+    if (threads <= 1)
+        return compute_vertex_normals(vertices, indices);
+    int n = (int)threads;
+
+    // Each thread sums its share of the triangles into a private buffer that
+    // spans only the vertex IDs those triangles use
+    struct Partial {
+        uint32_t first, last;
+        std::vector<float> sums;
+    };
+    std::vector<Partial> partials(n);
+    run_threads(n, [&](int s) {
+        size_t t0 = triangles * s / n, t1 = triangles * (s + 1) / n;
+        Partial& p = partials[s];
+        p.first = *std::min_element(indices.begin() + t0 * 3, indices.begin() + t1 * 3);
+        p.last = *std::max_element(indices.begin() + t0 * 3, indices.begin() + t1 * 3);
+        p.sums.assign(((size_t)p.last - p.first + 1) * 3, 0.0f);
+        accumulate_face_normals(vertices, indices, t0, t1, p.first, p.sums.data());
+    });
+
+    // Then each thread adds up the partial sums for a range of vertices, in
+    // thread order so the result does not depend on scheduling, and normalizes
+    size_t vertexCount = vertices.size() / 3;
+    std::vector<float> normals(vertices.size(), 0.0f);
+    run_threads(n, [&](int s) {
+        size_t v0 = vertexCount * s / n, v1 = vertexCount * (s + 1) / n;
+        for (int t = 0; t < n; ++t) {
+            const Partial& p = partials[t];
+            size_t begin = std::max(v0, (size_t)p.first);
+            size_t end = std::min(v1, (size_t)p.last + 1);
+            for (size_t i = begin * 3; i < end * 3; ++i)
+                normals[i] += p.sums[i - (size_t)p.first * 3];
+        }
+        normalize_normals(normals.data() + v0 * 3, normals.data() + v1 * 3);
+    });
     return normals;
-}
\ No newline at end of file
+}
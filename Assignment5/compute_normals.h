@@ -2,7 +2,35 @@
 #define COMPUTE_NORMALS_H
 
 #include <vector>
+#include <cstdint>
+#include <cstddef>
 
 std::vector<float> compute_normals(const std::vector<float>& vertices);
 
+// Same as above for count triangles (9 floats each) in a caller-owned buffer;
+// writes 9 floats per triangle to normals. Used on streamed triangle batches.
+// Normalizes 8 (AVX2) or 4 (SSE2) triangles at a time with an rsqrt estimate
+// plus one Newton step, so results differ from the scalar version by a few ulps.
+void compute_normals(const float* triangles, size_t count, float* normals);
+
+// Plain scalar version of the above (one sqrt and three divides per triangle).
+void compute_normals_scalar(const float* triangles, size_t count, float* normals);
+
+// Name of the instruction set compute_normals was compiled for.
+const char* compute_normals_isa();
+
+// Smooth per-vertex normals for an indexed mesh: each vertex gets the
+// normalized sum of the (area-weighted) normals of the triangles using it.
+std::vector<float> compute_vertex_normals(const std::vector<float>& vertices, const std::vector<uint32_t>& indices);
+
+// Same as above on numThreads threads (<= 0: all hardware threads). Each thread
+// accumulates a contiguous range of triangles into its own buffer, sized to the
+// vertex IDs that range touches (a small window for marching cubes output,
+// whose vertex IDs follow triangle order), and the buffers are then summed per
+// vertex in parallel. No atomics; the result is the same for every run with a
+// given thread count and matches the serial one up to rounding. Small meshes
+// are done on one thread.
+std::vector<float> compute_vertex_normals(const std::vector<float>& vertices, const std::vector<uint32_t>& indices,
+                                          int numThreads);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "decimate.h"
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// Weight of the constraint planes along open edges, relative to a triangle plane
+static const double BOUNDARY_WEIGHT = 100.0;
+
+// Symmetric 4x4 matrix sum of p p^T over planes p = (a, b, c, d), upper triangle
+// stored row by row. Evaluating it at (x, y, z, 1) gives the sum of squared
+// distances to those planes.
+struct Quadric {
+    double q[10];
+
+    Quadric() { std::fill(q, q + 10, 0.0); }
+
+    void addPlane(double a, double b, double c, double d, double w) {
+        q[0] += w * a * a; q[1] += w * a * b; q[2] += w * a * c; q[3] += w * a * d;
+        q[4] += w * b * b; q[5] += w * b * c; q[6] += w * b * d;
+        q[7] += w * c * c; q[8] += w * c * d;
+        q[9] += w * d * d;
+    }
+    void add(const Quadric& o) {
+        for (int i = 0; i < 10; ++i)
+            q[i] += o.q[i];
+    }
+    double error(const double p[3]) const {
+        double x = p[0], y = p[1], z = p[2];
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+             + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+             + q[7] * z * z + 2 * q[8] * z
+             + q[9];
+    }
+    // The point minimizing the error, if the 3x3 system is well conditioned
+    bool minimum(double p[3]) const {
+        double a = q[0], b = q[1], c = q[2], d = q[4], e = q[5], f = q[7];
+        double det = a * (d * f - e * e) - b * (b * f - c * e) + c * (b * e - c * d);
+        double scale = std::fabs(a) + std::fabs(d) + std::fabs(f);
+        if (std::fabs(det) <= 1e-9 * scale * scale * scale)
+            return false;
+        double r0 = -q[3], r1 = -q[6], r2 = -q[8];
+        p[0] = (r0 * (d * f - e * e) - b * (r1 * f - e * r2) + c * (r1 * e - d * r2)) / det;
+        p[1] = (a * (r1 * f - e * r2) - r0 * (b * f - c * e) + c * (b * r2 - r1 * c)) / det;
+        p[2] = (a * (d * r2 - r1 * e) - b * (b * r2 - r1 * c) + r0 * (b * e - c * d)) / det;
+        return true;
+    }
+};
+
+// A queued edge collapse. It is stale once either end has been changed since
+// it was queued (the version numbers no longer match).
+struct Collapse {
+    double cost;          // merged quadric error, constraint planes included
+    double surfaceCost;   // the triangle planes' part of it: summed squared distances
+    uint32_t a, b;
+    uint32_t versionA, versionB;
+    double p[3];
+
+    bool operator>(const Collapse& o) const { return cost > o.cost; }
+};
+
+static void cross(const double u[3], const double v[3], double out[3]) {
+    out[0] = u[1] * v[2] - u[2] * v[1];
+    out[1] = u[2] * v[0] - u[0] * v[2];
+    out[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+namespace {
+
+class Decimator {
+public:
+    explicit Decimator(const IndexedMesh& mesh);
+    void run(size_t targetTriangles, float maxError);
+    IndexedMesh result() const;
+
+    size_t liveFaces;
+    float worstError;   // largest surface error of the collapses made
+
+private:
+    void faceNormal(uint32_t f, const double* moved, uint32_t movedVertex, double n[3]) const;
+    Collapse plan(uint32_t a, uint32_t b) const;
+    bool allowed(const Collapse& c) const;
+    void collapse(const Collapse& c);
+    void neighbours(uint32_t v, std::vector<uint32_t>& out) const;
+
+    std::vector<double> pos;                       // 3 per vertex
+    std::vector<Quadric> quadrics;                 // triangle planes
+    std::vector<Quadric> constraints;              // open-edge constraint planes
+    std::vector<uint32_t> version;
+    std::vector<char> vertexAlive, boundary;
+    std::vector<std::vector<uint32_t> > vertexFaces;
+    std::vector<uint32_t> faces;                   // 3 per face
+    std::vector<char> faceAlive;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > queue;
+    mutable std::vector<uint32_t> ringA, ringB, common;   // scratch for allowed()
+};
+
+} // namespace
+
+Decimator::Decimator(const IndexedMesh& mesh) : liveFaces(mesh.indices.size() / 3), worstError(0.0f) {
+    size_t vertexCount = mesh.vertices.size() / 3;
+    pos.assign(mesh.vertices.begin(), mesh.vertices.end());
+    quadrics.resize(vertexCount);
+    constraints.resize(vertexCount);
+    version.assign(vertexCount, 0);
+    vertexAlive.assign(vertexCount, 1);
+    boundary.assign(vertexCount, 0);
+    vertexFaces.resize(vertexCount);
+    faces.assign(mesh.indices.begin(), mesh.indices.begin() + liveFaces * 3);
+    faceAlive.assign(liveFaces, 1);
+
+    // Plane quadric of every triangle onto its corners
+    std::vector<double> planes(liveFaces * 4);
+    for (size_t f = 0; f < liveFaces; ++f) {
+        const double* v0 = &pos[faces[f * 3] * 3];
+        const double* v1 = &pos[faces[f * 3 + 1] * 3];
+        const double* v2 = &pos[faces[f * 3 + 2] * 3];
+        double e1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+        double e2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+        double* n = &planes[f * 4];
+        cross(e1, e2, n);
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0) {
+            n[0] /= length; n[1] /= length; n[2] /= length;
+        }
+        n[3] = -(n[0] * v0[0] + n[1] * v0[1] + n[2] * v0[2]);
+        for (int c = 0; c < 3; ++c) {
+            quadrics[faces[f * 3 + c]].addPlane(n[0], n[1], n[2], n[3], 1.0);
+            vertexFaces[faces[f * 3 + c]].push_back((uint32_t)f);
+        }
+    }
+
+    // Unique edges, sorted, with the face that first listed them. An edge used
+    // by one face is open and gets a constraint plane through it, perpendicular
+    // to that face.
+    std::vector<std::pair<uint64_t, uint32_t> > edges;
+    edges.reserve(liveFaces * 3);
+    for (size_t f = 0; f < liveFaces; ++f)
+        for (int c = 0; c < 3; ++c) {
+            uint32_t a = faces[f * 3 + c], b = faces[f * 3 + (c + 1) % 3];
+            edges.push_back(std::make_pair((uint64_t)std::min(a, b) << 32 | std::max(a, b), (uint32_t)f));
+        }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j].first == edges[i].first)
+            ++j;
+        uint32_t a = (uint32_t)(edges[i].first >> 32), b = (uint32_t)edges[i].first;
+        if (j - i == 1) {
+            const double* pa = &pos[a * 3];
+            const double* pb = &pos[b * 3];
+            const double* n = &planes[edges[i].second * 4];
+            double e[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            double m[3];
+            cross(e, n, m);
+            double length = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+            if (length > 0.0) {
+                m[0] /= length; m[1] /= length; m[2] /= length;
+                double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                constraints[a].addPlane(m[0], m[1], m[2], d, BOUNDARY_WEIGHT);
+                constraints[b].addPlane(m[0], m[1], m[2], d, BOUNDARY_WEIGHT);
+            }
+            boundary[a] = boundary[b] = 1;
+        }
+        i = j;
+    }
+    for (size_t i = 0; i < edges.size(); ++i)
+        if (i == 0 || edges[i].first != edges[i - 1].first)
+            queue.push(plan((uint32_t)(edges[i].first >> 32), (uint32_t)edges[i].first));
+}
+
+// Normal of face f, with movedVertex (if it is a corner) placed at moved
+void Decimator::faceNormal(uint32_t f, const double* moved, uint32_t movedVertex, double n[3]) const {
+    const double* v[3];
+    for (int c = 0; c < 3; ++c)
+        v[c] = faces[f * 3 + c] == movedVertex ? moved : &pos[faces[f * 3 + c] * 3];
+    double e1[3] = {v[1][0] - v[0][0], v[1][1] - v[0][1], v[1][2] - v[0][2]};
+    double e2[3] = {v[2][0] - v[0][0], v[2][1] - v[0][1], v[2][2] - v[0][2]};
+    cross(e1, e2, n);
+}
+
+Collapse Decimator::plan(uint32_t a, uint32_t b) const {
+    Quadric surface = quadrics[a];
+    surface.add(quadrics[b]);
+    Quadric q = surface;
+    q.add(constraints[a]);
+    q.add(constraints[b]);
+
+    Collapse c;
+    c.a = a;
+    c.b = b;
+    c.versionA = version[a];
+    c.versionB = version[b];
+
+    // The quadric's minimum if it exists and stays near the edge, otherwise the
+    // best of the two ends and the midpoint
+    const double* pa = &pos[a * 3];
+    const double* pb = &pos[b * 3];
+    double mid[3] = {(pa[0] + pb[0]) * 0.5, (pa[1] + pb[1]) * 0.5, (pa[2] + pb[2]) * 0.5};
+    double edge2 = (pb[0] - pa[0]) * (pb[0] - pa[0]) + (pb[1] - pa[1]) * (pb[1] - pa[1]) + (pb[2] - pa[2]) * (pb[2] - pa[2]);
+    double best[3];
+    if (q.minimum(best)) {
+        double dx = best[0] - mid[0], dy = best[1] - mid[1], dz = best[2] - mid[2];
+        if (dx * dx + dy * dy + dz * dz <= 4.0 * edge2) {
+            std::copy(best, best + 3, c.p);
+            c.cost = q.error(c.p);
+            c.surfaceCost = surface.error(c.p);
+            return c;
+        }
+    }
+    const double* options[3] = {pa, pb, mid};
+    c.cost = -1.0;
+    for (int i = 0; i < 3; ++i) {
+        double e = q.error(options[i]);
+        if (c.cost < 0.0 || e < c.cost) {
+            c.cost = e;
+            std::copy(options[i], options[i] + 3, c.p);
+        }
+    }
+    c.surfaceCost = surface.error(c.p);
+    return c;
+}
+
+void Decimator::neighbours(uint32_t v, std::vector<uint32_t>& out) const {
+    out.clear();
+    for (size_t i = 0; i < vertexFaces[v].size(); ++i) {
+        uint32_t f = vertexFaces[v][i];
+        if (!faceAlive[f])
+            continue;
+        for (int c = 0; c < 3; ++c)
+            if (faces[f * 3 + c] != v)
+                out.push_back(faces[f * 3 + c]);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// Whether collapsing c keeps the mesh manifold and no triangle flips over
+bool Decimator::allowed(const Collapse& c) const {
+    // Faces on the edge itself; they vanish in the collapse
+    size_t shared = 0;
+    for (size_t i = 0; i < vertexFaces[c.a].size(); ++i) {
+        uint32_t f = vertexFaces[c.a][i];
+        if (faceAlive[f] && (faces[f * 3] == c.b || faces[f * 3 + 1] == c.b || faces[f * 3 + 2] == c.b))
+            ++shared;
+    }
+    // Joining two border vertices across the inside would pinch the surface
+    if (shared != 1 && boundary[c.a] && boundary[c.b])
+        return false;
+
+    // Link condition: the ends may only share the vertices opposite the edge
+    neighbours(c.a, ringA);
+    neighbours(c.b, ringB);
+    common.clear();
+    std::set_intersection(ringA.begin(), ringA.end(), ringB.begin(), ringB.end(), std::back_inserter(common));
+    if (common.size() != shared)
+        return false;
+
+    // No surviving face may turn over
+    for (int end = 0; end < 2; ++end) {
+        uint32_t v = end == 0 ? c.a : c.b;
+        uint32_t other = end == 0 ? c.b : c.a;
+        for (size_t i = 0; i < vertexFaces[v].size(); ++i) {
+            uint32_t f = vertexFaces[v][i];
+            if (!faceAlive[f] || faces[f * 3] == other || faces[f * 3 + 1] == other || faces[f * 3 + 2] == other)
+                continue;
+            double before[3], after[3];
+            faceNormal(f, &pos[v * 3], v, before);
+            faceNormal(f, c.p, v, after);
+            if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Merges b into a at c.p and queues the edges around a again
+void Decimator::collapse(const Collapse& c) {
+    std::copy(c.p, c.p + 3, &pos[c.a * 3]);
+    quadrics[c.a].add(quadrics[c.b]);
+    constraints[c.a].add(constraints[c.b]);
+    boundary[c.a] = boundary[c.a] || boundary[c.b];
+    vertexAlive[c.b] = 0;
+    ++version[c.a];
+
+    std::vector<uint32_t> kept;
+    for (size_t i = 0; i < vertexFaces[c.a].size(); ++i) {
+        uint32_t f = vertexFaces[c.a][i];
+        if (!faceAlive[f])
+            continue;
+        uint32_t* t = &faces[f * 3];
+        if (t[0] == c.b || t[1] == c.b || t[2] == c.b) {
+            faceAlive[f] = 0;
+            --liveFaces;
+        } else {
+            kept.push_back(f);
+        }
+    }
+    for (size_t i = 0; i < vertexFaces[c.b].size(); ++i) {
+        uint32_t f = vertexFaces[c.b][i];
+        if (!faceAlive[f])
+            continue;
+        uint32_t* t = &faces[f * 3];
+        for (int k = 0; k < 3; ++k)
+            if (t[k] == c.b)
+                t[k] = c.a;
+        kept.push_back(f);
+    }
+    vertexFaces[c.a].swap(kept);
+    std::vector<uint32_t>().swap(vertexFaces[c.b]);
+
+    neighbours(c.a, ringA);
+    for (size_t i = 0; i < ringA.size(); ++i)
+        queue.push(plan(c.a, ringA[i]));
+}
+
+void Decimator::run(size_t targetTriangles, float maxError) {
+    double maxCost = (double)maxError * maxError;
+    while (liveFaces > targetTriangles && !queue.empty()) {
+        Collapse c = queue.top();
+        queue.pop();
+        if (!vertexAlive[c.a] || !vertexAlive[c.b] || version[c.a] != c.versionA || version[c.b] != c.versionB)
+            continue;
+        // Only the triangle planes count towards the bound. The queue is ordered
+        // by the full cost, which the constraint planes raise near open edges,
+        // so a collapse over the bound is skipped rather than ending the run.
+        if (maxError > 0.0f && c.surfaceCost > maxCost)
+            continue;
+        if (!allowed(c))
+            continue;
+        collapse(c);
+        worstError = std::max(worstError, (float)std::sqrt(std::max(c.surfaceCost, 0.0)));
+    }
+}
+
+IndexedMesh Decimator::result() const {
+    IndexedMesh out;
+    std::vector<uint32_t> remap(vertexAlive.size(), UINT32_MAX);
+    out.indices.reserve(liveFaces * 3);
+    for (size_t f = 0; f < faceAlive.size(); ++f) {
+        if (!faceAlive[f])
+            continue;
+        for (int c = 0; c < 3; ++c) {
+            uint32_t v = faces[f * 3 + c];
+            if (remap[v] == UINT32_MAX) {
+                remap[v] = (uint32_t)(out.vertices.size() / 3);
+                for (int k = 0; k < 3; ++k)
+                    out.vertices.push_back((float)pos[v * 3 + k]);
+            }
+            out.indices.push_back(remap[v]);
+        }
+    }
+    return out;
+}
+
+IndexedMesh decimate(const IndexedMesh& mesh, size_t targetTriangles, float maxError, DecimateStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Decimator decimator(mesh);
+    decimator.run(targetTriangles, maxError);
+    IndexedMesh out = decimator.result();
+    if (stats) {
+        stats->inputTriangles = mesh.indices.size() / 3;
+        stats->outputTriangles = out.indices.size() / 3;
+        stats->maxError = decimator.worstError;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return out;
+}
@@ -0,0 +1,31 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include <cstddef>
+#include "marching_cubes.h" // IndexedMesh
+
+// What a decimate() call did.
+struct DecimateStats {
+    size_t inputTriangles;
+    size_t outputTriangles;
+    float maxError;   // largest surface error of the collapses made
+    double seconds;
+};
+
+// Quadric error mesh simplification (Garland and Heckbert 1997) for welded
+// meshes such as marching_cubes_indexed output. Every vertex carries the sum of
+// the squared-distance quadrics of the planes of its triangles; edges are
+// collapsed cheapest first from a priority queue, each into the point that
+// minimizes the merged quadric. Open edges (e.g. where the surface leaves the
+// meshed box) get extra constraint planes so the border keeps its shape, and
+// collapses that would flip a triangle or pinch the surface are skipped.
+// A collapse's surface error is the square root of the summed squared
+// distances from its point to the original triangle planes merged into it, so
+// it bounds the point's distance to each of them; the constraint planes only
+// steer the ordering. Stops when the mesh is down to targetTriangles or no
+// collapse with a surface error of at most maxError is left (pass 0 for
+// either to ignore it).
+// Runs in O(n log n). The result has no normals; stats may be null.
+IndexedMesh decimate(const IndexedMesh& mesh, size_t targetTriangles, float maxError, DecimateStats* stats);
+
+#endif // DECIMATE_H
@@ -0,0 +1,241 @@
+#include "fields.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FIELDS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FIELDS_SSE2 1
+#endif
+
+//function for x2−y2−z2−z with an isovalue of -1.5
+float myFunction1(float x, float y, float z) {
+    return x*x-y*y-z*z-z;
+}
+//y − sin(x)cos(z) with an isovalue of 0
+float myFunction2(float x, float y, float z) {
+    return y - sin(x)*cos(z);
+}
+// Sphere equation
+float sphere_function(float x, float y, float z) {
+    return x * x + y * y + z * z - 1.0f;
+}
+// Torus around the z axis
+float torus_function(float x, float y, float z) {
+    float major_radius = 1.0f;  // Major radius of the torus
+    float minor_radius = 0.3f;  // Minor radius of the torus
+
+    float dist_to_ring = sqrt(x * x + y * y) - major_radius;
+    return dist_to_ring * dist_to_ring + z * z - minor_radius * minor_radius;
+}
+// Terrain: a few octaves of sines, so it carries on past the [-5, 5] box
+float terrain_function(float x, float y, float z) {
+    float height = 1.2f * sin(0.31f * x) * cos(0.27f * z)
+                 + 0.5f * sin(0.83f * x + 0.61f * z)
+                 + 0.25f * cos(1.7f * z - 0.9f * x);
+    return y - height;
+}
+// Ripples spreading from the y axis, for the animation mode
+float ripple_function(float x, float y, float z, float t) {
+    float r = sqrt(x * x + z * z);
+    return y - 1.5f * sin(1.5f * r - 3.0f * t) * exp(-0.25f * r);
+}
+
+// Analytic gradients of the fields above
+void myFunction1_gradient(float x, float y, float z, float* g) {
+    g[0] = 2.0f * x;
+    g[1] = -2.0f * y;
+    g[2] = -2.0f * z - 1.0f;
+}
+void myFunction2_gradient(float x, float y, float z, float* g) {
+    (void)y;
+    g[0] = -cos(x) * cos(z);
+    g[1] = 1.0f;
+    g[2] = sin(x) * sin(z);
+}
+void sphere_gradient(float x, float y, float z, float* g) {
+    g[0] = 2.0f * x;
+    g[1] = 2.0f * y;
+    g[2] = 2.0f * z;
+}
+void torus_gradient(float x, float y, float z, float* g) {
+    float r = sqrt(x * x + y * y);
+    float scale = r > 0.0f ? 2.0f * (r - 1.0f) / r : 0.0f;
+    g[0] = scale * x;
+    g[1] = scale * y;
+    g[2] = 2.0f * z;
+}
+
+// ---------------------------------------------------------------------------
+// Polynomial cosine shared by every batch path. The argument is reduced to
+// [-pi/4, pi/4] around the nearest multiple of pi/2 (pi/2 split in three parts
+// so the reduction stays exact for the |z| ranges we mesh), then evaluated with
+// the Cephes single precision sin/cos polynomials. The SIMD versions below do
+// the same operations in the same order, so all paths agree bit for bit.
+// ---------------------------------------------------------------------------
+static const float TWO_OVER_PI = 0.636619772367581343f;
+static const float PIO2_1 = 1.5703125f;
+static const float PIO2_2 = 4.837512969970703125e-4f;
+static const float PIO2_3 = 7.54978995489188216e-8f;
+static const float SIN_C1 = -1.6666654611e-1f;
+static const float SIN_C2 = 8.3321608736e-3f;
+static const float SIN_C3 = -1.9515295891e-4f;
+static const float COS_C1 = 4.166664568298827e-2f;
+static const float COS_C2 = -1.388731625493765e-3f;
+static const float COS_C3 = 2.443315711809948e-5f;
+
+static inline float cos_poly(float z) {
+    float q = std::nearbyint(z * TWO_OVER_PI);
+    int quadrant = (int)q;
+    float r = ((z - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+    float r2 = r * r;
+    float s = r + (r * r2) * (SIN_C1 + r2 * (SIN_C2 + r2 * SIN_C3));
+    float c = (1.0f - 0.5f * r2) + (r2 * r2) * (COS_C1 + r2 * (COS_C2 + r2 * COS_C3));
+    // cos(q*pi/2 + r) = c, -s, -c, s for q mod 4 = 0, 1, 2, 3
+    float v = (quadrant & 1) ? s : c;
+    return ((quadrant + 1) & 2) ? -v : v;
+}
+
+#if FIELDS_AVX2
+static inline __m256 cos_poly(__m256 z) {
+    __m256i qi = _mm256_cvtps_epi32(_mm256_mul_ps(z, _mm256_set1_ps(TWO_OVER_PI)));
+    __m256 q = _mm256_cvtepi32_ps(qi);
+    __m256 r = _mm256_sub_ps(z, _mm256_mul_ps(q, _mm256_set1_ps(PIO2_1)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(q, _mm256_set1_ps(PIO2_2)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(q, _mm256_set1_ps(PIO2_3)));
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 ps = _mm256_add_ps(_mm256_set1_ps(SIN_C2), _mm256_mul_ps(r2, _mm256_set1_ps(SIN_C3)));
+    ps = _mm256_add_ps(_mm256_set1_ps(SIN_C1), _mm256_mul_ps(r2, ps));
+    __m256 s = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), ps));
+
+    __m256 pc = _mm256_add_ps(_mm256_set1_ps(COS_C2), _mm256_mul_ps(r2, _mm256_set1_ps(COS_C3)));
+    pc = _mm256_add_ps(_mm256_set1_ps(COS_C1), _mm256_mul_ps(r2, pc));
+    __m256 c = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)),
+                             _mm256_mul_ps(_mm256_mul_ps(r2, r2), pc));
+
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 odd = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(qi, one), one));
+    __m256 v = _mm256_blendv_ps(c, s, odd);
+    __m256i sign = _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(qi, one), _mm256_set1_epi32(2)), 30);
+    return _mm256_xor_ps(v, _mm256_castsi256_ps(sign));
+}
+#elif FIELDS_SSE2
+static inline __m128 cos_poly(__m128 z) {
+    __m128i qi = _mm_cvtps_epi32(_mm_mul_ps(z, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 q = _mm_cvtepi32_ps(qi);
+    __m128 r = _mm_sub_ps(z, _mm_mul_ps(q, _mm_set1_ps(PIO2_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_3)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 ps = _mm_add_ps(_mm_set1_ps(SIN_C2), _mm_mul_ps(r2, _mm_set1_ps(SIN_C3)));
+    ps = _mm_add_ps(_mm_set1_ps(SIN_C1), _mm_mul_ps(r2, ps));
+    __m128 s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), ps));
+
+    __m128 pc = _mm_add_ps(_mm_set1_ps(COS_C2), _mm_mul_ps(r2, _mm_set1_ps(COS_C3)));
+    pc = _mm_add_ps(_mm_set1_ps(COS_C1), _mm_mul_ps(r2, pc));
+    __m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)),
+                          _mm_mul_ps(_mm_mul_ps(r2, r2), pc));
+
+    __m128i one = _mm_set1_epi32(1);
+    __m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(qi, one), one));
+    __m128 v = _mm_or_ps(_mm_and_ps(odd, s), _mm_andnot_ps(odd, c));
+    __m128i sign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(qi, one), _mm_set1_epi32(2)), 30);
+    return _mm_xor_ps(v, _mm_castsi128_ps(sign));
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Batch kernels. Terms that only depend on (x, y) are hoisted out of the row;
+// the remaining z-dependent part is evaluated 8 or 4 lanes at a time, with a
+// scalar loop for the tail (or the whole row when no SIMD is available).
+// ---------------------------------------------------------------------------
+void myFunction1_batch(float x, float y, const float* zs, int count, float* out) {
+    float c = x*x-y*y;
+    int k = 0;
+#if FIELDS_AVX2
+    __m256 vc = _mm256_set1_ps(c);
+    for (; k + 8 <= count; k += 8) {
+        __m256 z = _mm256_loadu_ps(zs + k);
+        _mm256_storeu_ps(out + k, _mm256_sub_ps(_mm256_sub_ps(vc, _mm256_mul_ps(z, z)), z));
+    }
+#elif FIELDS_SSE2
+    __m128 vc = _mm_set1_ps(c);
+    for (; k + 4 <= count; k += 4) {
+        __m128 z = _mm_loadu_ps(zs + k);
+        _mm_storeu_ps(out + k, _mm_sub_ps(_mm_sub_ps(vc, _mm_mul_ps(z, z)), z));
+    }
+#endif
+    for (; k < count; ++k)
+        out[k] = c-zs[k]*zs[k]-zs[k];
+}
+
+void myFunction2_batch(float x, float y, const float* zs, int count, float* out) {
+    float s = sin(x);
+    int k = 0;
+#if FIELDS_AVX2
+    __m256 vy = _mm256_set1_ps(y), vs = _mm256_set1_ps(s);
+    for (; k + 8 <= count; k += 8)
+        _mm256_storeu_ps(out + k, _mm256_sub_ps(vy, _mm256_mul_ps(vs, cos_poly(_mm256_loadu_ps(zs + k)))));
+#elif FIELDS_SSE2
+    __m128 vy = _mm_set1_ps(y), vs = _mm_set1_ps(s);
+    for (; k + 4 <= count; k += 4)
+        _mm_storeu_ps(out + k, _mm_sub_ps(vy, _mm_mul_ps(vs, cos_poly(_mm_loadu_ps(zs + k)))));
+#endif
+    for (; k < count; ++k)
+        out[k] = y - s*cos_poly(zs[k]);
+}
+
+void sphere_function_batch(float x, float y, const float* zs, int count, float* out) {
+    float c = x * x + y * y;
+    int k = 0;
+#if FIELDS_AVX2
+    __m256 vc = _mm256_set1_ps(c), one = _mm256_set1_ps(1.0f);
+    for (; k + 8 <= count; k += 8) {
+        __m256 z = _mm256_loadu_ps(zs + k);
+        _mm256_storeu_ps(out + k, _mm256_sub_ps(_mm256_add_ps(vc, _mm256_mul_ps(z, z)), one));
+    }
+#elif FIELDS_SSE2
+    __m128 vc = _mm_set1_ps(c), one = _mm_set1_ps(1.0f);
+    for (; k + 4 <= count; k += 4) {
+        __m128 z = _mm_loadu_ps(zs + k);
+        _mm_storeu_ps(out + k, _mm_sub_ps(_mm_add_ps(vc, _mm_mul_ps(z, z)), one));
+    }
+#endif
+    for (; k < count; ++k)
+        out[k] = c + zs[k] * zs[k] - 1.0f;
+}
+
+void torus_function_batch(float x, float y, const float* zs, int count, float* out) {
+    float dist_to_ring = sqrt(x * x + y * y) - 1.0f;
+    float d2 = dist_to_ring * dist_to_ring;
+    float r2 = 0.3f * 0.3f;
+    int k = 0;
+#if FIELDS_AVX2
+    __m256 vd = _mm256_set1_ps(d2), vr = _mm256_set1_ps(r2);
+    for (; k + 8 <= count; k += 8) {
+        __m256 z = _mm256_loadu_ps(zs + k);
+        _mm256_storeu_ps(out + k, _mm256_sub_ps(_mm256_add_ps(vd, _mm256_mul_ps(z, z)), vr));
+    }
+#elif FIELDS_SSE2
+    __m128 vd = _mm_set1_ps(d2), vr = _mm_set1_ps(r2);
+    for (; k + 4 <= count; k += 4) {
+        __m128 z = _mm_loadu_ps(zs + k);
+        _mm_storeu_ps(out + k, _mm_sub_ps(_mm_add_ps(vd, _mm_mul_ps(z, z)), vr));
+    }
+#endif
+    for (; k < count; ++k)
+        out[k] = d2 + zs[k] * zs[k] - r2;
+}
+
+const char* batch_field_isa() {
+#if FIELDS_AVX2
+    return "avx2";
+#elif FIELDS_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,40 @@
+#ifndef FIELDS_H
+#define FIELDS_H
+
+#include "marching_cubes.h"
+
+// Scalar fields used by the viewer and the benchmark.
+
+// x^2 - y^2 - z^2 - z, meshed at isovalue -1.5
+float myFunction1(float x, float y, float z);
+// y - sin(x)cos(z), meshed at isovalue 0
+float myFunction2(float x, float y, float z);
+// x^2 + y^2 + z^2 - 1, the unit sphere at isovalue 0
+float sphere_function(float x, float y, float z);
+// Torus around the z axis (major radius 1, minor radius 0.3) at isovalue 0
+float torus_function(float x, float y, float z);
+// Rolling terrain y - h(x, z) at isovalue 0, unbounded in x and z with |h| < 2
+float terrain_function(float x, float y, float z);
+// Time-varying ripples y - h(x, z, t) at isovalue 0, see AnimatedMesher
+float ripple_function(float x, float y, float z, float t);
+
+// Analytic gradients of the fields above, matching GradientField in marching_cubes.h.
+void myFunction1_gradient(float x, float y, float z, float* g);
+void myFunction2_gradient(float x, float y, float z, float* g);
+void sphere_gradient(float x, float y, float z, float* g);
+void torus_gradient(float x, float y, float z, float* g);
+
+// Batched versions of the fields above, matching BatchField in marching_cubes.h.
+// They use AVX2 (8 lanes) or SSE2 (4 lanes) when the compiler targets them,
+// with a scalar loop otherwise.
+// myFunction2_batch evaluates cos with a polynomial instead of libm, so its
+// values can differ from myFunction2 in the last couple of bits.
+void myFunction1_batch(float x, float y, const float* zs, int count, float* out);
+void myFunction2_batch(float x, float y, const float* zs, int count, float* out);
+void sphere_function_batch(float x, float y, const float* zs, int count, float* out);
+void torus_function_batch(float x, float y, const float* zs, int count, float* out);
+
+// Name of the instruction set the batch kernels were compiled for.
+const char* batch_field_isa();
+
+#endif // FIELDS_H
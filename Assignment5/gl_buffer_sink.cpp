@@ -0,0 +1,68 @@
+#include "gl_buffer_sink.h"
+#include "compute_normals.h"
+
+GLBufferSink::GLBufferSink(size_t initialTriangles)
+    : vbo(0), capacity(0), vertices(0) {
+    grow(initialTriangles > 0 ? initialTriangles * 3 : 3);
+}
+
+void GLBufferSink::append(const float* positions, size_t count) {
+    if (count == 0)
+        return;
+    size_t n = count * 3;
+    if (vertices + n > capacity)
+        grow(vertices + n);
+
+    normals.resize(count * 9);
+    compute_normals(positions, count, normals.data());
+    staging.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Vertex& v = staging[i];
+        v.x = positions[i * 3 + 0];
+        v.y = positions[i * 3 + 1];
+        v.z = positions[i * 3 + 2];
+        v.nx = normals[i * 3 + 0];
+        v.ny = normals[i * 3 + 1];
+        v.nz = normals[i * 3 + 2];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, vertices * sizeof(Vertex), n * sizeof(Vertex), staging.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertices += n;
+}
+
+void GLBufferSink::grow(size_t minVertices) {
+    size_t newCapacity = capacity > 0 ? capacity : 1;
+    while (newCapacity < minVertices)
+        newCapacity *= 2;
+
+    GLuint newVbo;
+    glGenBuffers(1, &newVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, newVbo);
+    glBufferData(GL_ARRAY_BUFFER, newCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+
+    if (vertices > 0) {
+        GLsizeiptr bytes = vertices * sizeof(Vertex);
+        if (GLEW_VERSION_3_1 || GLEW_ARB_copy_buffer) {
+            glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, 0, bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        } else {
+            // Legacy contexts (e.g. the macOS 2.1 profile): map the old buffer on a
+            // target that is not part of any VAO state and upload from the mapping.
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, vbo);
+            const void* old = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_READ_ONLY);
+            if (old)
+                glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, old);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (vbo)
+        glDeleteBuffers(1, &vbo);
+    vbo = newVbo;
+    capacity = newCapacity;
+}
@@ -0,0 +1,35 @@
+#ifndef GL_BUFFER_SINK_H
+#define GL_BUFFER_SINK_H
+
+#include <vector>
+#include <cstddef>
+#include <GL/glew.h>
+#include "write_ply.h" // Vertex
+
+// A GL vertex buffer that triangle batches are appended to as they are
+// extracted (pass append to marching_cubes_stream). Each triangle becomes three
+// Vertex entries with its face normal, the same layout as bindMesh uses. When
+// the buffer fills up, its capacity doubles and the old contents are copied on
+// the GPU, so the CPU only ever holds one batch.
+// The caller owns buffer() and deletes it when done.
+class GLBufferSink {
+public:
+    explicit GLBufferSink(size_t initialTriangles = 1 << 16);
+
+    // Appends count triangles, 9 floats each. Needs a current GL context.
+    void append(const float* positions, size_t count);
+
+    GLuint buffer() const { return vbo; }
+    size_t vertexCount() const { return vertices; }
+
+private:
+    void grow(size_t minVertices);
+
+    GLuint vbo;
+    size_t capacity;  // in vertices
+    size_t vertices;
+    std::vector<float> normals;
+    std::vector<Vertex> staging;
+};
+
+#endif // GL_BUFFER_SINK_H
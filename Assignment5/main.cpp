@@ -7,6 +7,8 @@
 #include <sstream>
 #include <cstdlib>
 #include <cmath>
+#include <string>
+#include <memory>
 
 // OpenGL, GLFW and GLEW
 #include <GL/glew.h>
@@ -23,15 +25,14 @@
 #include "write_ply.h"
 #include "camera.h"
 #include "shader_utils.h"
+#include "fields.h"
+#include "gl_buffer_sink.h"
+#include "volume.h"
+#include "chunk_manager.h"
+#include "decimate.h"
+#include "animated_mesher.h"
+#include "octahedral.h"
 
-//function for x2−y2−z2−z with an isovalue of -1.5
-float myFunction1(float x, float y, float z) {
-    return x*x-y*y-z*z-z;
-}
-//y − sin(x)cos(z) with an isovalue of 0
-float myFunction2(float x, float y, float z) {
-    return y - sin(x)*cos(z);
-}
 void drawBox() {
 
     // Define the min and max corners of the marching volume
@@ -163,26 +164,103 @@ std::vector<Vertex> createMesh(const std::vector<float>& positions, const std::v
     return mesh;
 }
 
+// Helper: Point the VAO's attributes at VBO, laid out as Vertex, or as
+// PackedVertex (octahedral normals) if packed is set
+void setVertexFormat(GLuint VBO, GLuint VAO, bool packed) {
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    if (packed) {
+        // Attribute 0: Position (vec3); attribute 1: 2 snorm16 normal components
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (GLvoid*)0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid*)offsetof(PackedVertex, n));
+    } else {
+        // Attribute 0: Position (vec3), starting at offset 0
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        // Attribute 1: Normal (vec3), starting at offset of nx
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, nx));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+}
+
+// Helper: Create a VAO reading Vertex data from an existing VBO
+void bindVertexBuffer(GLuint VBO, GLuint &VAO) {
+    glGenVertexArrays(1, &VAO);
+    setVertexFormat(VBO, VAO, false);
+}
+
 // Helper: Bind mesh data (vector<Vertex>) to a VAO and VBO for rendering
 void bindMesh(const std::vector<Vertex>& mesh, GLuint &VAO) {
     GLuint VBO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    
     glGenBuffers(1, &VBO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(Vertex), mesh.data(), GL_STATIC_DRAW);
-    
-    // Attribute 0: Position (vec3), starting at offset 0
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    // Attribute 1: Normal (vec3), starting at offset of nx
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, nx));
-    glEnableVertexAttribArray(1);
-    
+    bindVertexBuffer(VBO, VAO);
+}
+
+// Helper: Create a VAO for an indexed mesh stored in VBO (Vertex data) and EBO (triangle indices).
+// The element buffer binding is recorded in the VAO, so drawing only needs glDrawElements.
+void bindIndexedMesh(GLuint VBO, GLuint EBO, GLuint &VAO) {
+    bindVertexBuffer(VBO, VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBindVertexArray(0);
 }
 
+// Helper: Replace the contents of VBO and EBO with a welded isosurface, using
+// its smooth normals (from marching_cubes_indexed_normals), and set VAO up to
+// read it. With packed set the normals are stored octahedral-encoded in 4 bytes
+// (shader uniform packedNormals). Writes the mesh to plyFile as well unless it
+// is null. Returns the index count.
+GLsizei uploadIsosurface(const IndexedMesh& surface, GLuint VAO, GLuint VBO, GLuint EBO, const char* plyFile,
+                         bool packed) {
+    const std::vector<float>& normals = surface.normals;
+    if (plyFile)
+        writePLY(surface.vertices, normals, surface.indices, plyFile);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (packed) {
+        std::vector<PackedVertex> mesh = pack_vertices(surface.vertices, normals);
+        glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(PackedVertex), mesh.data(), GL_DYNAMIC_DRAW);
+    } else {
+        // Convert positions and normals into a vector of Vertex structs
+        std::vector<Vertex> mesh = createMesh(surface.vertices, normals);
+        glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(Vertex), mesh.data(), GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    setVertexFormat(VBO, VAO, packed);
+    // Bind the element buffer outside any VAO so no VAO state changes
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, surface.indices.size() * sizeof(uint32_t), surface.indices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return (GLsizei)surface.indices.size();
+}
+
+// Updates the window title with the isovalue being shown.
+void showIsovalue(GLFWwindow* window, float isovalue) {
+    std::ostringstream title;
+    title << "Assignment 5 - isovalue " << isovalue;
+    glfwSetWindowTitle(window, title.str().c_str());
+}
+
+// Updates the window title with the number of triangles drawn.
+void showTriangleCount(GLFWwindow* window, size_t triangles) {
+    std::ostringstream title;
+    title << "Assignment 5 - " << triangles << " triangles";
+    glfwSetWindowTitle(window, title.str().c_str());
+}
+
+// Updates the window title with the animation time and the dropped frame count.
+void showAnimation(GLFWwindow* window, float time, size_t droppedFrames) {
+    std::ostringstream title;
+    title << "Assignment 5 - t = " << time << " s, " << droppedFrames << " dropped frames";
+    glfwSetWindowTitle(window, title.str().c_str());
+}
+
 int main(int argc, char* argv[]) {
     // Default parameters
     float screenW = 800;
@@ -191,6 +269,17 @@ int main(int argc, char* argv[]) {
     if (argc > 1) screenW = atof(argv[1]);
     if (argc > 2) screenH = atof(argv[2]);
     if (argc > 3) stepsize = atof(argv[3]);
+    // "stream": extract straight into the PLY file and GL buffer, for fine step sizes.
+    // "terrain": endless terrain meshed in chunks around the camera.
+    // "animate": a time-varying field re-meshed on a worker thread every frame.
+    // Anything else is a raw volume file to mesh instead of the analytic field,
+    // optionally followed by the isovalue to start at.
+    bool streamMesh = argc > 4 && std::string(argv[4]) == "stream";
+    bool terrainMode = argc > 4 && std::string(argv[4]) == "terrain";
+    bool animateMode = argc > 4 && std::string(argv[4]) == "animate";
+    const char* volumeFile = (argc > 4 && !streamMesh && !terrainMode && !animateMode) ? argv[4] : nullptr;
+    float isovalue = -1.5f;
+    if (volumeFile && argc > 5) isovalue = atof(argv[5]);
     
     // Initialize GLFW
     if (!glfwInit()){
@@ -240,21 +329,122 @@ int main(int argc, char* argv[]) {
     
     // Generate mesh from the scalar field (using the sphere function)
     float min_bound = -5.0f, max_bound = 5.0f;
-    std::vector<float> positions = marching_cubes(myFunction1, -1.5, min_bound, max_bound, stepsize);
-    std::vector<float> normals = compute_normals(positions);
-    // Export mesh for inspection (optional)
-    writePLY(positions, normals, "output_mesh.ply");
-    
-    // Convert positions and normals into a vector of Vertex structs
-    std::vector<Vertex> mesh = createMesh(positions, normals);
-    
-    // Bind mesh data into a VAO for shader-based rendering
-    bindMesh(mesh, VAO);
+    ScalarGrid grid;
+    MappedVolume volume;
+    IndexedMesh surface;   // welded mesh on screen (grid and volume modes)
+    bool packedNormals = false;   // surface uploaded with octahedral normals (N toggles)
+    GLuint meshEBO = 0;
+    GLsizei drawCount = 0;
+    std::unique_ptr<ChunkManager> terrain;
+    size_t shownTriangles = 0;
+    std::unique_ptr<AnimatedMesher> animation;
+    size_t shownMeshes = 0;
+    if (animateMode) {
+        // Three buffer sets: one on screen, one the GPU may still be reading, one to upload into
+        animation.reset(new AnimatedMesher(ripple_function, 0.0f, min_bound, max_bound, stepsize, 3, 0));
+    } else if (terrainMode) {
+        // 8x8 columns over y in [-3, 3], meshed on background threads out to 40
+        // units from the camera at four levels of detail; up to 300 chunks stay
+        // cached. The step is rounded to a power of two so neighbouring chunks
+        // sample their shared faces exactly.
+        float chunkStep = std::exp2(std::round(std::log2(stepsize)));
+        terrain.reset(new ChunkManager(terrain_function, 0.0f, 8.0f, -3.0f, 3.0f, chunkStep, 40.0f, 4, 300, 0));
+    } else if (streamMesh) {
+        // Flat-shaded triangles go to a binary PLY file and a growing vertex
+        // buffer in fixed-size batches, so memory stays bounded at any stepsize
+        PLYStreamWriter ply("output_mesh.ply");
+        GLBufferSink gpuMesh;
+        marching_cubes_stream(myFunction1_batch, isovalue, min_bound, max_bound, stepsize, 1 << 16,
+                              [&](const float* triangles, size_t count) {
+                                  ply.append(triangles, count);
+                                  gpuMesh.append(triangles, count);
+                              });
+        ply.close();
+
+        meshVBO = gpuMesh.buffer();
+        bindVertexBuffer(meshVBO, VAO);
+        drawCount = (GLsizei)gpuMesh.vertexCount();
+    } else {
+        if (volumeFile) {
+            // Sampled data: the file is memory-mapped and read in place
+            if (!volume.open(volumeFile)) {
+                glfwTerminate();
+                return -1;
+            }
+            // Without an isovalue argument, start halfway through the sampled range
+            if (argc <= 5) {
+                float lo, hi;
+                volume.valueRange(lo, hi);
+                isovalue = 0.5f * (lo + hi);
+            }
+        } else {
+            // Sample the field once and keep the grid resident, so changing the
+            // isovalue (left/right arrows) only re-runs classification and interpolation
+            grid = sample_grid(myFunction1_batch, min_bound, max_bound, stepsize, 0);
+        }
+        glGenBuffers(1, &meshVBO);
+        glGenBuffers(1, &meshEBO);
+        bindIndexedMesh(meshVBO, meshEBO, VAO);
+        // Welded output: each crossed lattice edge becomes one shared vertex
+        surface = volumeFile ? marching_cubes_indexed_normals(volume.view(), isovalue, 0)
+                             : marching_cubes_indexed_normals(grid, isovalue, 0);
+        drawCount = uploadIsosurface(surface, VAO, meshVBO, meshEBO, "output_mesh.ply", packedNormals);
+        showIsovalue(window, isovalue);
+    }
+
+    // Isovalue change per frame while an arrow key is held, scaled to the sample type
+    float isoStep = 0.02f;
+    if (volumeFile && volume.view().type == SAMPLE_UINT8) isoStep = 0.5f;
+    if (volumeFile && volume.view().type == SAMPLE_UINT16) isoStep = 64.0f;
     
+    bool decimateKeyWasDown = false;
+    bool packKeyWasDown = false;
+
     // Main render loop
     do {
         // Update camera using first-person controls (this updates the view matrix V)
         cameraFirstPerson(window, V, 10.0f);
+
+        // Left/right arrows scrub the isovalue (hold shift for bigger steps); the
+        // new mesh is extracted from the cached grid and uploaded before drawing
+        if (!streamMesh && !terrainMode && !animateMode) {
+            float step = isoStep;
+            if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) step *= 10.0f;
+            float isoDelta = 0.0f;
+            if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) isoDelta += step;
+            if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) isoDelta -= step;
+            if (isoDelta != 0.0f) {
+                isovalue += isoDelta;
+                surface = volumeFile ? marching_cubes_indexed_normals(volume.view(), isovalue, 0)
+                                     : marching_cubes_indexed_normals(grid, isovalue, 0);
+                drawCount = uploadIsosurface(surface, VAO, meshVBO, meshEBO, nullptr, packedNormals);
+                showIsovalue(window, isovalue);
+            }
+
+            // D (once per press) decimates the mesh on screen to a tenth of its
+            // triangles, shows it and writes it to output_mesh_decimated.ply
+            bool decimateKey = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+            if (decimateKey && !decimateKeyWasDown && !surface.indices.empty()) {
+                DecimateStats stats;
+                surface = decimate(surface, surface.indices.size() / 3 / 10, 0.0f, &stats);
+                surface.normals = compute_vertex_normals(surface.vertices, surface.indices, 0);
+                drawCount = uploadIsosurface(surface, VAO, meshVBO, meshEBO, "output_mesh_decimated.ply", packedNormals);
+                std::cout << "Decimated " << stats.inputTriangles << " -> " << stats.outputTriangles
+                          << " triangles in " << stats.seconds << " s (error " << stats.maxError << ")" << std::endl;
+            }
+            decimateKeyWasDown = decimateKey;
+
+            // N (once per press) switches the mesh on screen between float and
+            // octahedral 16-bit normals, re-uploading it
+            bool packKey = glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS;
+            if (packKey && !packKeyWasDown && !surface.indices.empty()) {
+                packedNormals = !packedNormals;
+                drawCount = uploadIsosurface(surface, VAO, meshVBO, meshEBO, nullptr, packedNormals);
+                std::cout << (packedNormals ? "Octahedral normals, " : "Float normals, ")
+                          << (packedNormals ? sizeof(PackedVertex) : sizeof(Vertex)) << " bytes per vertex" << std::endl;
+            }
+            packKeyWasDown = packKey;
+        }
         
         // Clear the screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -294,10 +484,28 @@ int main(int argc, char* argv[]) {
         glUniform3f(ambColLoc,   0.2f, 0.2f, 0.2f);
         glUniform3f(specColLoc,  1.0f, 1.0f, 1.0f);
         glUniform1f(shininessLoc, 64.0f);
+        glUniform1i(glGetUniformLocation(shaderProgram, "packedNormals"), packedNormals);
 
         // Now bind your VAO and draw
         glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, mesh.size());
+        if (terrainMode) {
+            terrain->update(cameraPosition());
+            terrain->draw();
+            if (terrain->visibleTriangles() != shownTriangles) {
+                shownTriangles = terrain->visibleTriangles();
+                showTriangleCount(window, shownTriangles);
+            }
+        } else if (animateMode) {
+            animation->update();
+            animation->draw();
+            if (animation->meshesShown() != shownMeshes) {
+                shownMeshes = animation->meshesShown();
+                showAnimation(window, animation->shownTime(), animation->droppedFrames());
+            }
+        } else if (streamMesh)
+            glDrawArrays(GL_TRIANGLES, 0, drawCount);
+        else
+            glDrawElements(GL_TRIANGLES, drawCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
         
         // Now switch to fixed-function mode
@@ -318,7 +526,16 @@ int main(int argc, char* argv[]) {
     } while( glfwGetKey(window, GLFW_KEY_ESCAPE ) != GLFW_PRESS && glfwWindowShouldClose(window) == 0 );
     
     // Cleanup: delete VAO (and any other buffers if needed)
+    if (animation)
+        std::cout << "Animation: " << animation->frames() << " frames, " << animation->meshesShown()
+                  << " meshes, " << animation->droppedFrames() << " dropped frames" << std::endl;
+    animation.reset();
+    terrain.reset();
     glDeleteVertexArrays(1, &VAO);
+    if (meshVBO)
+        glDeleteBuffers(1, &meshVBO);
+    if (meshEBO)
+        glDeleteBuffers(1, &meshEBO);
     
     glfwTerminate();
     return 0;
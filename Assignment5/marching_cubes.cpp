@@ -1,7 +1,11 @@
 #include "marching_cubes.h"
-#include "TriTable.hpp"  // This should define marching_cubes_lut[256][16]
+#include "mc_tables.hpp"
 #include <cmath>
 #include <vector>
+#include <thread>
+#include <functional>
+#include <utility>
+#include <algorithm>
 
 // Standard table mapping each of the 12 edges to its two corner indices.
 static const int edgeEndpoints[12][2] = {
@@ -10,85 +14,1357 @@ static const int edgeEndpoints[12][2] = {
     {0, 4}, {1, 5}, {2, 6}, {3, 7}    // vertical edges
 };
 
-std::vector<float> marching_cubes(float (*f)(float, float, float), float isovalue,
-                                    float min, float max, float stepsize) {
+// Offset of each cube corner from the cell origin, in lattice steps (x, y, z).
+static const int cornerOffset[8][3] = {
+    {0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1},
+    {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}
+};
+
+// For each cube edge: the corner at its lower lattice end and the axis it runs
+// along (0 = x, 1 = y, 2 = z). The lower corner's lattice point plus the axis is
+// the edge's unique ID, shared by every cell that touches it.
+static const int edgeLowCorner[12] = {0, 1, 3, 0, 4, 5, 7, 4, 0, 1, 2, 3};
+static const int edgeAxis[12]      = {0, 2, 0, 2, 0, 2, 0, 2, 1, 1, 1, 1};
+
+// Lattice coordinates along one axis, accumulated exactly like the original
+// `for (x = min; x < max; x += stepsize)` loop. The extra trailing entry is the
+// far corner of the last cell, so coords[i + 1] == coords[i] + stepsize bit for bit.
+std::vector<float> mc_detail::lattice_coords(float min, float max, float stepsize) {
+    std::vector<float> coords;
+    float c = min;
+    for (; c < max; c += stepsize)
+        coords.push_back(c);
+    coords.push_back(c);
+    return coords;
+}
+
+// Writes vertices into a preallocated buffer; stands in for std::vector in
+// march_cell_row when the output size is known up front.
+struct VertexCursor {
+    float* p;
+    void push_back(float v) { *p++ = v; }
+};
+
+// Runs marching cubes over the cells (j, k0..k1-1) between the lattice planes x
+// and x1, reading corner values from the pre-sampled slices v0 (at x) and v1
+// (at x1). Triangles are appended in the same z order as the original loop.
+// T is the stored sample type; values are converted to float as they are read.
+template <typename T, typename VertexOut>
+static void march_cell_row(const T* v0, const T* v1, float x, float x1,
+                           const std::vector<float>& ys, const std::vector<float>& zs,
+                           int j, int k0, int k1, float isovalue, VertexOut& vertices) {
+    int stride = (int)zs.size();
+    float y = ys[j], y1 = ys[j + 1];
+    const T* a0 = v0 + j * stride;   // (x,  y)
+    const T* a1 = v1 + j * stride;   // (x1, y)
+    const T* b0 = a0 + stride;       // (x,  y1)
+    const T* b1 = a1 + stride;       // (x1, y1)
+    for (int k = k0; k < k1; ++k) {
+        float z = zs[k], z1 = zs[k + 1];
+
+        // Scalar field values at the 8 cube corners, read from the cache
+        float values[8];
+        values[0] = (float)a0[k];
+        values[1] = (float)a1[k];
+        values[2] = (float)a1[k + 1];
+        values[3] = (float)a0[k + 1];
+        values[4] = (float)b0[k];
+        values[5] = (float)b1[k];
+        values[6] = (float)b1[k + 1];
+        values[7] = (float)b0[k + 1];
+
+        // Determine cube configuration index using bitmasking
+        int cubeIndex = 0;
+        if (values[0] < isovalue) cubeIndex |= 1;
+        if (values[1] < isovalue) cubeIndex |= 2;
+        if (values[2] < isovalue) cubeIndex |= 4;
+        if (values[3] < isovalue) cubeIndex |= 8;
+        if (values[4] < isovalue) cubeIndex |= 16;
+        if (values[5] < isovalue) cubeIndex |= 32;
+        if (values[6] < isovalue) cubeIndex |= 64;
+        if (values[7] < isovalue) cubeIndex |= 128;
+
+        int triangles = mcTriangleCount[cubeIndex];
+        if (triangles == 0)
+            continue;  // No intersections in this cube
+
+        // Store the 3D positions of each corner
+        float cornerPos[8][3] = {
+            {x, y, z},
+            {x1, y, z},
+            {x1, y, z1},
+            {x, y, z1},
+            {x, y1, z},
+            {x1, y1, z},
+            {x1, y1, z1},
+            {x, y1, z1}
+        };
+
+        // Interpolate each edge the surface crosses once, rather than once per
+        // triangle that uses it
+        float edgeVerts[12][3];
+        int cut = mcEdgeMask[cubeIndex];
+        for (int edgeIndex = 0; edgeIndex < 12; ++edgeIndex) {
+            if (!(cut & (1 << edgeIndex)))
+                continue;
+            // Get the two endpoints (corner indices) of this edge, lower lattice
+            // end first so neighbouring cells place the crossing identically
+            int c1 = edgeLowCorner[edgeIndex];
+            int c2 = edgeEndpoints[edgeIndex][0] == c1 ? edgeEndpoints[edgeIndex][1]
+                                                       : edgeEndpoints[edgeIndex][0];
+
+            // Compute the interpolation factor alpha.
+            // Guard against division by zero.
+            float f1 = values[c1];
+            float f2 = values[c2];
+            float alpha = 0.5f; // default to midpoint if f2 == f1
+            if (fabs(f2 - f1) > 1e-6)
+                alpha = (isovalue - f1) / (f2 - f1);
+
+            // Interpolate between the two corner positions:
+            for (int c = 0; c < 3; ++c)
+                edgeVerts[edgeIndex][c] = cornerPos[c1][c] + alpha * (cornerPos[c2][c] - cornerPos[c1][c]);
+        }
+
+        // Emit 3 vertices per triangle listed for this configuration
+        const int8_t* edgeList = mcTriangles[cubeIndex];
+        for (int t = 0; t < triangles * 3; ++t) {
+            const float* v = edgeVerts[edgeList[t]];
+            vertices.push_back(v[0]);
+            vertices.push_back(v[1]);
+            vertices.push_back(v[2]);
+        }
+    }
+}
+
+// Crossing points of the lattice edges a slab's surface cuts, 3 floats each:
+// x edges between the two planes of the current slice pair, and y/z edges on
+// the two planes bounding it, stored by plane index parity. Each entry is
+// stamped with the plane index it was computed for, so entries left over from
+// earlier slices are recognised as stale without clearing anything.
+struct EdgeCrossings {
+    std::vector<float> xEdges;          // [(j * (nz + 1) + k) * 3]
+    std::vector<int> xStamps;           // [j * (nz + 1) + k]
+    std::vector<float> planeEdges[2];   // [((j * (nz + 1) + k) * 2 + axis - 1) * 3]
+    std::vector<int> planeStamps[2];    // [(j * (nz + 1) + k) * 2 + axis - 1]
+};
+
+// Runs marching cubes over the whole row of cells between the lattice planes
+// x = xs[i] and x1 = xs[i + 1], in the same y/z order as the original triple
+// loop. Each crossing is interpolated by the first cell that reaches its edge
+// and looked up by every later cell and triangle using it, including the cells
+// of the next slice pair when the same crossings are passed on. The output is
+// the same as march_cell_row over every cell.
+template <typename T, typename VertexOut>
+static void march_slice_pair(const T* v0, const T* v1, int i, float x, float x1,
+                             const std::vector<float>& ys, const std::vector<float>& zs,
+                             float isovalue, EdgeCrossings& crossings, VertexOut& vertices) {
+    int ny = (int)ys.size() - 1;
+    int nz = (int)zs.size() - 1;
+    int stride = nz + 1;
+    size_t points = ys.size() * zs.size();
+    if (crossings.xStamps.size() != points) {
+        crossings.xEdges.resize(points * 3);
+        crossings.xStamps.assign(points, -1);
+        for (int p = 0; p < 2; ++p) {
+            crossings.planeEdges[p].resize(points * 6);
+            crossings.planeStamps[p].assign(points * 2, -1);
+        }
+    }
+
+    for (int j = 0; j < ny; ++j) {
+        float y = ys[j], y1 = ys[j + 1];
+        const T* a0 = v0 + j * stride;
+        const T* a1 = v1 + j * stride;
+        const T* b0 = a0 + stride;
+        const T* b1 = a1 + stride;
+        for (int k = 0; k < nz; ++k) {
+            float values[8];
+            values[0] = (float)a0[k];
+            values[1] = (float)a1[k];
+            values[2] = (float)a1[k + 1];
+            values[3] = (float)a0[k + 1];
+            values[4] = (float)b0[k];
+            values[5] = (float)b1[k];
+            values[6] = (float)b1[k + 1];
+            values[7] = (float)b0[k + 1];
+
+            int cubeIndex = 0;
+            if (values[0] < isovalue) cubeIndex |= 1;
+            if (values[1] < isovalue) cubeIndex |= 2;
+            if (values[2] < isovalue) cubeIndex |= 4;
+            if (values[3] < isovalue) cubeIndex |= 8;
+            if (values[4] < isovalue) cubeIndex |= 16;
+            if (values[5] < isovalue) cubeIndex |= 32;
+            if (values[6] < isovalue) cubeIndex |= 64;
+            if (values[7] < isovalue) cubeIndex |= 128;
+
+            int triangles = mcTriangleCount[cubeIndex];
+            if (triangles == 0)
+                continue;
+
+            float z = zs[k], z1 = zs[k + 1];
+            float cornerPos[8][3] = {
+                {x, y, z}, {x1, y, z}, {x1, y, z1}, {x, y, z1},
+                {x, y1, z}, {x1, y1, z}, {x1, y1, z1}, {x, y1, z1}
+            };
+
+            const int8_t* edgeList = mcTriangles[cubeIndex];
+            for (int t = 0; t < triangles * 3; ++t) {
+                int edgeIndex = edgeList[t];
+                int lo = edgeLowCorner[edgeIndex];
+                int axis = edgeAxis[edgeIndex];
+
+                // Find the cache slot of this lattice edge
+                int slot = (j + cornerOffset[lo][1]) * stride + k + cornerOffset[lo][2];
+                int plane = i + cornerOffset[lo][0];
+                int* stamp;
+                float* p;
+                if (axis == 0) {
+                    stamp = &crossings.xStamps[slot];
+                    p = &crossings.xEdges[slot * 3];
+                } else {
+                    int e = slot * 2 + axis - 1;
+                    stamp = &crossings.planeStamps[plane & 1][e];
+                    p = &crossings.planeEdges[plane & 1][e * 3];
+                }
+
+                if (*stamp != plane) {
+                    // First cell to reach this edge: interpolate the crossing
+                    int hi = edgeEndpoints[edgeIndex][0] == lo ? edgeEndpoints[edgeIndex][1]
+                                                               : edgeEndpoints[edgeIndex][0];
+                    float f1 = values[lo];
+                    float f2 = values[hi];
+                    float alpha = 0.5f;
+                    if (fabs(f2 - f1) > 1e-6)
+                        alpha = (isovalue - f1) / (f2 - f1);
+                    for (int c = 0; c < 3; ++c)
+                        p[c] = cornerPos[lo][c] + alpha * (cornerPos[hi][c] - cornerPos[lo][c]);
+                    *stamp = plane;
+                }
+
+                vertices.push_back(p[0]);
+                vertices.push_back(p[1]);
+                vertices.push_back(p[2]);
+            }
+        }
+    }
+}
+
+// Counts the triangles march_slice_pair would emit, classifying the cells only.
+// The cells that produce any (as j * nz + k) are appended to cells.
+static size_t count_slice_pair(const float* v0, const float* v1, int ny, int nz,
+                               float isovalue, std::vector<uint32_t>& cells) {
+    int stride = nz + 1;
+    size_t triangles = 0;
+    for (int j = 0; j < ny; ++j) {
+        const float* a0 = v0 + j * stride;
+        const float* a1 = v1 + j * stride;
+        const float* b0 = a0 + stride;
+        const float* b1 = a1 + stride;
+        for (int k = 0; k < nz; ++k) {
+            int cubeIndex = 0;
+            if (a0[k] < isovalue) cubeIndex |= 1;
+            if (a1[k] < isovalue) cubeIndex |= 2;
+            if (a1[k + 1] < isovalue) cubeIndex |= 4;
+            if (a0[k + 1] < isovalue) cubeIndex |= 8;
+            if (b0[k] < isovalue) cubeIndex |= 16;
+            if (b1[k] < isovalue) cubeIndex |= 32;
+            if (b1[k + 1] < isovalue) cubeIndex |= 64;
+            if (b0[k + 1] < isovalue) cubeIndex |= 128;
+            int n = mcTriangleCount[cubeIndex];
+            if (n == 0)
+                continue;
+            triangles += n;
+            cells.push_back((uint32_t)(j * nz + k));
+        }
+    }
+    return triangles;
+}
+
+// Meshes the cells whose x index lies in [i0, i1), sampling the field into a
+// rolling pair of y/z slices so every lattice point is evaluated once per slab.
+static void march_slab(const mc_detail::SliceSampler& sample, float isovalue,
+                       const std::vector<float>& xs, const std::vector<float>& ys,
+                       const std::vector<float>& zs, int i0, int i1,
+                       std::vector<float>& vertices) {
+    size_t sliceSize = ys.size() * zs.size();
+    std::vector<float> sliceA(sliceSize), sliceB(sliceSize);
+    float* cur = sliceA.data();
+    float* next = sliceB.data();
+
+    EdgeCrossings crossings;
+    sample(xs[i0], cur);
+    for (int i = i0; i < i1; ++i) {
+        sample(xs[i + 1], next);
+        march_slice_pair(cur, next, i, xs[i], xs[i + 1], ys, zs, isovalue, crossings, vertices);
+        std::swap(cur, next);
+    }
+}
+
+// Meshes the cells whose x index lies in [i0, i1) of a lattice that is already
+// sampled, reading the corners in place (a ScalarGrid or a mapped volume).
+template <typename T>
+static void march_lattice_slab(const T* values, const std::vector<float>& xs,
+                               const std::vector<float>& ys, const std::vector<float>& zs,
+                               float isovalue, int i0, int i1, std::vector<float>& vertices) {
+    size_t sliceSize = ys.size() * zs.size();
+    EdgeCrossings crossings;
+    for (int i = i0; i < i1; ++i) {
+        const T* v0 = values + i * sliceSize;
+        march_slice_pair(v0, v0 + sliceSize, i, xs[i], xs[i + 1], ys, zs, isovalue, crossings, vertices);
+    }
+}
+
+// Welded-vertex state for one slab. Vertex IDs are cached per lattice edge:
+// x edges for the current row of cells, and y/z edges for the two lattice
+// planes bounding it. -1 marks an edge whose crossing has not been emitted yet.
+struct IndexedSlab {
+    IndexedMesh mesh;
+    std::vector<int> xEdges;          // [j * (nz + 1) + k]
+    std::vector<int> planeEdges[2];   // [(j * (nz + 1) + k) * 2 + axis - 1]
+    std::vector<int> firstPlane;      // y/z edge IDs on the slab's first plane
+    std::vector<int> lastPlane;       // y/z edge IDs on the slab's last plane
+};
+
+// Vertex normal policies for the indexed extractor. When a crossing on the
+// lattice edge from point (i, j, k) along axis is placed at position (alpha of
+// the way along the edge), the policy appends its normal to normals, or does
+// nothing for NoNormals.
+struct NoNormals {
+    void operator()(int, int, int, int, float, const float*, std::vector<float>&) const {}
+};
+
+// Appends g normalized (or zero if g is zero) to normals.
+static void push_unit(const float g[3], std::vector<float>& normals) {
+    float length = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    for (int c = 0; c < 3; ++c)
+        normals.push_back(g[c] * scale);
+}
+
+// Central differences of a sampled lattice of T (one-sided on the border),
+// taken at both ends of the edge and interpolated like the position.
+template <typename T>
+struct GridNormals {
+    const T* values;
+    const std::vector<float>& xs;
+    const std::vector<float>& ys;
+    const std::vector<float>& zs;
+    size_t sliceSize, rowSize;
+
+    GridNormals(const T* values, const std::vector<float>& xs, const std::vector<float>& ys,
+                const std::vector<float>& zs)
+        : values(values), xs(xs), ys(ys), zs(zs), sliceSize(ys.size() * zs.size()), rowSize(zs.size()) {}
+
+    // Gradient of the lattice at point (i, j, k)
+    void gradient(int i, int j, int k, float g[3]) const {
+        const T* p = values + i * sliceSize + j * rowSize + k;
+        int il = i > 0, ih = i + 1 < (int)xs.size();
+        int jl = j > 0, jh = j + 1 < (int)ys.size();
+        int kl = k > 0, kh = k + 1 < (int)zs.size();
+        g[0] = ((float)p[ih * sliceSize] - (float)p[-(il * (ptrdiff_t)sliceSize)]) / (xs[i + ih] - xs[i - il]);
+        g[1] = ((float)p[jh * rowSize] - (float)p[-(jl * (ptrdiff_t)rowSize)]) / (ys[j + jh] - ys[j - jl]);
+        g[2] = ((float)p[kh] - (float)p[-kl]) / (zs[k + kh] - zs[k - kl]);
+    }
+    void operator()(int i, int j, int k, int axis, float alpha, const float*, std::vector<float>& normals) const {
+        float g0[3], g1[3], g[3];
+        gradient(i, j, k, g0);
+        gradient(i + (axis == 0), j + (axis == 1), k + (axis == 2), g1);
+        for (int c = 0; c < 3; ++c)
+            g[c] = g0[c] + alpha * (g1[c] - g0[c]);
+        push_unit(g, normals);
+    }
+};
+
+// Gradient of a point field at the vertex itself: the analytic gradient when
+// there is one, otherwise central differences of f with spacing h.
+struct FieldNormals {
+    float (*f)(float, float, float);
+    GradientField gradient;
+    float h;
+
+    void operator()(int, int, int, int, float, const float* p, std::vector<float>& normals) const {
+        float g[3];
+        if (gradient) {
+            gradient(p[0], p[1], p[2], g);
+        } else {
+            float inv = 0.5f / h;
+            g[0] = (f(p[0] + h, p[1], p[2]) - f(p[0] - h, p[1], p[2])) * inv;
+            g[1] = (f(p[0], p[1] + h, p[2]) - f(p[0], p[1] - h, p[2])) * inv;
+            g[2] = (f(p[0], p[1], p[2] + h) - f(p[0], p[1], p[2] - h)) * inv;
+        }
+        push_unit(g, normals);
+    }
+};
+
+// Indexed counterpart of march_slice_pair: each edge crossing becomes one vertex,
+// looked up through the edge caches so neighbouring cells reuse it. v0 is
+// lattice plane i; new vertices get a normal from the Normals policy.
+template <typename T, typename Normals>
+static void march_indexed_pair(const T* v0, const T* v1, int i, float x, float x1,
+                               const std::vector<float>& ys, const std::vector<float>& zs,
+                               float isovalue, int* xEdges, int* plane0, int* plane1,
+                               IndexedMesh& mesh, const Normals& normals) {
+    int ny = (int)ys.size() - 1;
+    int nz = (int)zs.size() - 1;
+    int stride = nz + 1;
+
+    for (int j = 0; j < ny; ++j) {
+        float y = ys[j], y1 = ys[j + 1];
+        const T* a0 = v0 + j * stride;
+        const T* a1 = v1 + j * stride;
+        const T* b0 = a0 + stride;
+        const T* b1 = a1 + stride;
+        for (int k = 0; k < nz; ++k) {
+            float values[8];
+            values[0] = (float)a0[k];
+            values[1] = (float)a1[k];
+            values[2] = (float)a1[k + 1];
+            values[3] = (float)a0[k + 1];
+            values[4] = (float)b0[k];
+            values[5] = (float)b1[k];
+            values[6] = (float)b1[k + 1];
+            values[7] = (float)b0[k + 1];
+
+            int cubeIndex = 0;
+            if (values[0] < isovalue) cubeIndex |= 1;
+            if (values[1] < isovalue) cubeIndex |= 2;
+            if (values[2] < isovalue) cubeIndex |= 4;
+            if (values[3] < isovalue) cubeIndex |= 8;
+            if (values[4] < isovalue) cubeIndex |= 16;
+            if (values[5] < isovalue) cubeIndex |= 32;
+            if (values[6] < isovalue) cubeIndex |= 64;
+            if (values[7] < isovalue) cubeIndex |= 128;
+
+            int triangles = mcTriangleCount[cubeIndex];
+            if (triangles == 0)
+                continue;
+
+            float z = zs[k], z1 = zs[k + 1];
+            float cornerPos[8][3] = {
+                {x, y, z}, {x1, y, z}, {x1, y, z1}, {x, y, z1},
+                {x, y1, z}, {x1, y1, z}, {x1, y1, z1}, {x, y1, z1}
+            };
+
+            const int8_t* edgeList = mcTriangles[cubeIndex];
+            for (int t = 0; t < triangles * 3; ++t) {
+                int edgeIndex = edgeList[t];
+                int lo = edgeLowCorner[edgeIndex];
+                int hi = edgeEndpoints[edgeIndex][0] == lo ? edgeEndpoints[edgeIndex][1]
+                                                           : edgeEndpoints[edgeIndex][0];
+                int axis = edgeAxis[edgeIndex];
+
+                // Find the cache slot of this lattice edge
+                int slot = (j + cornerOffset[lo][1]) * stride + k + cornerOffset[lo][2];
+                int* id;
+                if (axis == 0)
+                    id = &xEdges[slot];
+                else
+                    id = &(cornerOffset[lo][0] ? plane1 : plane0)[slot * 2 + axis - 1];
+
+                if (*id < 0) {
+                    // First cell to reach this edge: interpolate the crossing
+                    float f1 = values[lo];
+                    float f2 = values[hi];
+                    float alpha = 0.5f;
+                    if (fabs(f2 - f1) > 1e-6)
+                        alpha = (isovalue - f1) / (f2 - f1);
+
+                    *id = (int)(mesh.vertices.size() / 3);
+                    for (int c = 0; c < 3; ++c)
+                        mesh.vertices.push_back(cornerPos[lo][c] + alpha * (cornerPos[hi][c] - cornerPos[lo][c]));
+                    normals(i + cornerOffset[lo][0], j + cornerOffset[lo][1], k + cornerOffset[lo][2], axis,
+                            alpha, &mesh.vertices[mesh.vertices.size() - 3], mesh.normals);
+                }
+                mesh.indices.push_back((uint32_t)*id);
+            }
+        }
+    }
+}
+
+// Meshes cells [i0, i1) into slab.mesh. slicePair(i, v0, v1) must point v0/v1 at
+// the sampled lattice planes i and i + 1, stored as T.
+template <typename T, typename SlicePair, typename Normals>
+static void march_indexed_slab(SlicePair slicePair, const std::vector<float>& xs,
+                               const std::vector<float>& ys, const std::vector<float>& zs,
+                               float isovalue, int i0, int i1, const Normals& normals, IndexedSlab& slab) {
+    size_t planeSize = ys.size() * zs.size();
+    slab.xEdges.assign(planeSize, -1);
+    slab.planeEdges[0].assign(planeSize * 2, -1);
+    slab.planeEdges[1].assign(planeSize * 2, -1);
+    int cur = 0;
+
+    for (int i = i0; i < i1; ++i) {
+        const T* v0;
+        const T* v1;
+        slicePair(i, v0, v1);
+        std::fill(slab.xEdges.begin(), slab.xEdges.end(), -1);
+        march_indexed_pair(v0, v1, i, xs[i], xs[i + 1], ys, zs, isovalue, slab.xEdges.data(),
+                           slab.planeEdges[cur].data(), slab.planeEdges[1 - cur].data(), slab.mesh, normals);
+
+        if (i == i0)
+            slab.firstPlane = slab.planeEdges[cur];
+        std::fill(slab.planeEdges[cur].begin(), slab.planeEdges[cur].end(), -1);
+        cur = 1 - cur;
+    }
+    slab.lastPlane = slab.planeEdges[cur];
+}
+
+// Welds the per-slab meshes together. Crossings on the plane shared by two
+// neighbouring slabs were emitted by both; the later slab's copies are dropped
+// and remapped, so the result is the same for any number of slabs.
+static IndexedMesh merge_indexed_slabs(std::vector<IndexedSlab>& slabs) {
+    IndexedMesh out;
+    size_t totalVertices = 0, totalIndices = 0;
+    for (size_t s = 0; s < slabs.size(); ++s) {
+        totalVertices += slabs[s].mesh.vertices.size();
+        totalIndices += slabs[s].mesh.indices.size();
+    }
+    out.vertices.reserve(totalVertices);
+    out.indices.reserve(totalIndices);
+
+    bool withNormals = false;
+    for (size_t s = 0; s < slabs.size(); ++s)
+        withNormals = withNormals || !slabs[s].mesh.normals.empty();
+    if (withNormals)
+        out.normals.reserve(totalVertices);
+
+    std::vector<int> prevLast;   // previous slab's last-plane IDs, in output numbering
+    for (size_t s = 0; s < slabs.size(); ++s) {
+        IndexedSlab& slab = slabs[s];
+        size_t localCount = slab.mesh.vertices.size() / 3;
+        std::vector<int> remap(localCount, -1);
+
+        if (s > 0) {
+            for (size_t e = 0; e < slab.firstPlane.size(); ++e)
+                if (slab.firstPlane[e] >= 0 && prevLast[e] >= 0)
+                    remap[slab.firstPlane[e]] = prevLast[e];
+        }
+        for (size_t v = 0; v < localCount; ++v) {
+            if (remap[v] >= 0)
+                continue;
+            remap[v] = (int)(out.vertices.size() / 3);
+            out.vertices.insert(out.vertices.end(), slab.mesh.vertices.begin() + v * 3,
+                                slab.mesh.vertices.begin() + v * 3 + 3);
+            if (withNormals)
+                out.normals.insert(out.normals.end(), slab.mesh.normals.begin() + v * 3,
+                                   slab.mesh.normals.begin() + v * 3 + 3);
+        }
+        for (size_t t = 0; t < slab.mesh.indices.size(); ++t)
+            out.indices.push_back((uint32_t)remap[slab.mesh.indices[t]]);
+
+        prevLast.assign(slab.lastPlane.size(), -1);
+        for (size_t e = 0; e < slab.lastPlane.size(); ++e)
+            if (slab.lastPlane[e] >= 0)
+                prevLast[e] = remap[slab.lastPlane[e]];
+        slab = IndexedSlab();
+    }
+    return out;
+}
+
+// Splits [0, n) into at most numThreads contiguous slabs and runs job(s, i0, i1)
+// for each slab s on its own thread. Returns the number of slabs used.
+static int run_slabs(int n, int numThreads, const std::function<void(int, int, int)>& job) {
+    int slabs = resolve_thread_count(numThreads);
+    if (slabs > n) slabs = n;
+    if (slabs <= 1) {
+        job(0, 0, n);
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+    for (int s = 0; s < slabs; ++s) {
+        int i0 = (int)((long long)n * s / slabs);
+        int i1 = (int)((long long)n * (s + 1) / slabs);
+        workers.push_back(std::thread(job, s, i0, i1));
+    }
+    for (size_t s = 0; s < workers.size(); ++s)
+        workers[s].join();
+    return slabs;
+}
+
+// Concatenates per-slab vertex vectors in slab order, releasing each as it goes.
+static std::vector<float> merge_slabs(std::vector<std::vector<float> >& slabVertices) {
+    if (slabVertices.size() == 1)
+        return std::move(slabVertices[0]);
+
+    size_t total = 0;
+    for (size_t s = 0; s < slabVertices.size(); ++s)
+        total += slabVertices[s].size();
     std::vector<float> vertices;
-    
-    // Iterate over the 3D grid
-    for (float x = min; x < max; x += stepsize) {
-        for (float y = min; y < max; y += stepsize) {
-            for (float z = min; z < max; z += stepsize) {
+    vertices.reserve(total);
+    for (size_t s = 0; s < slabVertices.size(); ++s) {
+        vertices.insert(vertices.end(), slabVertices[s].begin(), slabVertices[s].end());
+        std::vector<float>().swap(slabVertices[s]);
+    }
+    return vertices;
+}
+
+int resolve_thread_count(int numThreads) {
+    if (numThreads > 0)
+        return numThreads;
+    unsigned int hw = std::thread::hardware_concurrency();
+    return hw > 0 ? (int)hw : 1;
+}
+
+std::vector<float> mc_detail::march_slices(const std::vector<float>& xs, const std::vector<float>& ys,
+                                           const std::vector<float>& zs, float isovalue, int numThreads,
+                                           const SliceSampler& sample) {
+    int nx = (int)xs.size() - 1;
+
+    // Each worker fills its own vector so no locking is needed in the hot loop;
+    // the slabs are concatenated in order so the buffer matches the serial result.
+    std::vector<std::vector<float> > slabVertices(resolve_thread_count(numThreads));
+    int slabs = run_slabs(nx, numThreads, [&](int s, int i0, int i1) {
+        march_slab(sample, isovalue, xs, ys, zs, i0, i1, slabVertices[s]);
+    });
+    slabVertices.resize(slabs);
+    return merge_slabs(slabVertices);
+}
+
+ScalarGrid mc_detail::sample_slices(const std::vector<float>& xs, const std::vector<float>& ys,
+                                    const std::vector<float>& zs, int numThreads,
+                                    const SliceSampler& sample) {
+    ScalarGrid grid;
+    grid.xs = xs;
+    grid.ys = ys;
+    grid.zs = zs;
+    size_t sliceSize = grid.ys.size() * grid.zs.size();
+    grid.values.resize(grid.xs.size() * sliceSize);
+
+    run_slabs((int)grid.xs.size(), numThreads, [&](int, int i0, int i1) {
+        for (int i = i0; i < i1; ++i)
+            sample(grid.xs[i], grid.values.data() + i * sliceSize);
+    });
+    return grid;
+}
+
+void mc_detail::march_stream(const std::vector<float>& xs, const std::vector<float>& ys,
+                             const std::vector<float>& zs, float isovalue, size_t batchTriangles,
+                             const SliceSampler& sample, const TriangleSink& sink) {
+    const size_t batchFloats = (batchTriangles > 0 ? batchTriangles : 1) * 9;
+    int nx = (int)xs.size() - 1;
+    int ny = (int)ys.size() - 1;
+    int nz = (int)zs.size() - 1;
+
+    size_t sliceSize = ys.size() * zs.size();
+    std::vector<float> sliceA(sliceSize), sliceB(sliceSize);
+    float* cur = sliceA.data();
+    float* next = sliceB.data();
+
+    // One row of cells adds at most 5 triangles per cell, so with this much
+    // room the pending buffer never reallocates.
+    std::vector<float> pending;
+    pending.reserve(batchFloats + (size_t)(nz > 0 ? nz : 0) * 5 * 9);
+
+    sample(xs[0], cur);
+    for (int i = 0; i < nx; ++i) {
+        sample(xs[i + 1], next);
+        for (int j = 0; j < ny; ++j) {
+            march_cell_row(cur, next, xs[i], xs[i + 1], ys, zs, j, 0, nz, isovalue, pending);
+            if (pending.size() < batchFloats)
+                continue;
+            // Hand over every full batch and keep the remainder for the next row
+            size_t done = 0;
+            for (; pending.size() - done >= batchFloats; done += batchFloats)
+                sink(pending.data() + done, batchFloats / 9);
+            pending.erase(pending.begin(), pending.begin() + done);
+        }
+        std::swap(cur, next);
+    }
+    if (!pending.empty())
+        sink(pending.data(), pending.size() / 9);
+}
+
+// Bounds every lattice value inside a block from the field at its 8 corners:
+// any point of the block is within half a diagonal of some corner, so with
+// |grad f| <= lipschitz its value lies in [min - L*h, max + L*h]. The block is
+// skipped when that whole interval is on one side of the isovalue.
+static bool block_may_cross(const float corners[8], float halfDiagonal, float lipschitz, float isovalue) {
+    float lo = corners[0], hi = corners[0];
+    for (int c = 1; c < 8; ++c) {
+        lo = std::min(lo, corners[c]);
+        hi = std::max(hi, corners[c]);
+    }
+    float slack = lipschitz * halfDiagonal;
+    return lo - slack < isovalue && hi + slack >= isovalue;
+}
+
+std::vector<float> mc_detail::march_sparse(const std::vector<float>& xs, const std::vector<float>& ys,
+                                           const std::vector<float>& zs, float isovalue, float lipschitz,
+                                           int blockSize, int numThreads, const RowSampler& sampleRow,
+                                           SparseStats* stats) {
+    const int B = blockSize > 0 ? blockSize : 1;
+    const int nx = (int)xs.size() - 1, ny = (int)ys.size() - 1, nz = (int)zs.size() - 1;
+    const int nbx = (nx + B - 1) / B, nby = (ny + B - 1) / B, nbz = (nz + B - 1) / B;
+
+    // Lattice index of block corner b along an axis with n cells
+    auto corner = [B](int b, int n) { return std::min(b * B, n); };
+
+    // Coarse pass: sample the field at every block corner
+    const int cy = nby + 1, cz = nbz + 1;
+    std::vector<float> coarse((size_t)(nbx + 1) * cy * cz);
+    run_slabs(nbx + 1, numThreads, [&](int, int c0, int c1) {
+        for (int ci = c0; ci < c1; ++ci)
+            for (int cj = 0; cj < cy; ++cj)
+                for (int ck = 0; ck < cz; ++ck) {
+                    int k = corner(ck, nz);
+                    sampleRow(xs[corner(ci, nx)], ys[corner(cj, ny)], k, k + 1,
+                              &coarse[((size_t)ci * cy + cj) * cz + ck]);
+                }
+    });
 
-                // Compute scalar field values at the 8 cube corners
+    // Classify blocks
+    std::vector<unsigned char> active((size_t)nbx * nby * nbz);
+    size_t activeCount = 0;
+    for (int bi = 0; bi < nbx; ++bi)
+        for (int bj = 0; bj < nby; ++bj)
+            for (int bk = 0; bk < nbz; ++bk) {
                 float values[8];
-                values[0] = f(x, y, z);
-                values[1] = f(x + stepsize, y, z);
-                values[2] = f(x + stepsize, y, z + stepsize);
-                values[3] = f(x, y, z + stepsize);
-                values[4] = f(x, y + stepsize, z);
-                values[5] = f(x + stepsize, y + stepsize, z);
-                values[6] = f(x + stepsize, y + stepsize, z + stepsize);
-                values[7] = f(x, y + stepsize, z + stepsize);
-
-                // Store the 3D positions of each corner
-                float cornerPos[8][3] = {
-                    {x, y, z},
-                    {x + stepsize, y, z},
-                    {x + stepsize, y, z + stepsize},
-                    {x, y, z + stepsize},
-                    {x, y + stepsize, z},
-                    {x + stepsize, y + stepsize, z},
-                    {x + stepsize, y + stepsize, z + stepsize},
-                    {x, y + stepsize, z + stepsize}
-                };
+                for (int c = 0; c < 8; ++c) {
+                    int ci = bi + cornerOffset[c][0], cj = bj + cornerOffset[c][1], ck = bk + cornerOffset[c][2];
+                    values[c] = coarse[((size_t)ci * cy + cj) * cz + ck];
+                }
+                float dx = xs[corner(bi + 1, nx)] - xs[corner(bi, nx)];
+                float dy = ys[corner(bj + 1, ny)] - ys[corner(bj, ny)];
+                float dz = zs[corner(bk + 1, nz)] - zs[corner(bk, nz)];
+                float halfDiagonal = 0.5f * std::sqrt(dx * dx + dy * dy + dz * dz);
+                bool live = block_may_cross(values, halfDiagonal, lipschitz, isovalue);
+                active[((size_t)bi * nby + bj) * nbz + bk] = live;
+                activeCount += live;
+            }
+
+    // Fine pass over the candidate blocks, one x layer of blocks at a time. Cells
+    // are visited in the usual x/y/z order (skipping inactive blocks), so the
+    // output matches marching_cubes whenever the Lipschitz bound holds.
+    std::vector<std::vector<float> > slabVertices(resolve_thread_count(numThreads));
+    std::vector<size_t> slabSamples(slabVertices.size(), 0);
+    int slabs = run_slabs(nbx, numThreads, [&](int s, int b0, int b1) {
+        size_t sliceSize = ys.size() * zs.size();
+        std::vector<float> sliceA(sliceSize), sliceB(sliceSize);
+        std::vector<unsigned char> needed(sliceSize);
+        std::vector<std::vector<std::pair<int, int> > > pointRuns(ny + 1);  // per lattice row j
+        std::vector<std::vector<std::pair<int, int> > > cellRuns(nby);      // per block row bj
+
+        // Samples the needed points of the y/z plane at x
+        auto sample = [&](float x, float* slice) {
+            for (int j = 0; j <= ny; ++j)
+                for (size_t r = 0; r < pointRuns[j].size(); ++r) {
+                    int k0 = pointRuns[j][r].first, k1 = pointRuns[j][r].second;
+                    sampleRow(x, ys[j], k0, k1, slice + (size_t)j * (nz + 1) + k0);
+                    slabSamples[s] += k1 - k0;
+                }
+        };
+
+        for (int bi = b0; bi < b1; ++bi) {
+            const unsigned char* layer = &active[(size_t)bi * nby * nbz];
+            bool any = false;
+            std::fill(needed.begin(), needed.end(), 0);
+            for (int bj = 0; bj < nby; ++bj) {
+                cellRuns[bj].clear();
+                for (int bk = 0; bk < nbz; ++bk) {
+                    if (!layer[bj * nbz + bk])
+                        continue;
+                    any = true;
+                    int k0 = corner(bk, nz), k1 = corner(bk + 1, nz);
+                    if (!cellRuns[bj].empty() && cellRuns[bj].back().second == k0)
+                        cellRuns[bj].back().second = k1;
+                    else
+                        cellRuns[bj].push_back(std::make_pair(k0, k1));
+                    for (int j = corner(bj, ny); j <= corner(bj + 1, ny); ++j)
+                        std::fill(&needed[(size_t)j * (nz + 1) + k0], &needed[(size_t)j * (nz + 1) + k1] + 1, 1);
+                }
+            }
+            if (!any)
+                continue;
+
+            for (int j = 0; j <= ny; ++j) {
+                pointRuns[j].clear();
+                const unsigned char* row = &needed[(size_t)j * (nz + 1)];
+                for (int k = 0; k <= nz; ++k) {
+                    if (!row[k])
+                        continue;
+                    int k0 = k;
+                    while (k <= nz && row[k]) ++k;
+                    pointRuns[j].push_back(std::make_pair(k0, k));
+                }
+            }
+
+            int i0 = corner(bi, nx), i1 = corner(bi + 1, nx);
+            float* cur = sliceA.data();
+            float* next = sliceB.data();
+            sample(xs[i0], cur);
+            for (int i = i0; i < i1; ++i) {
+                sample(xs[i + 1], next);
+                for (int bj = 0; bj < nby; ++bj) {
+                    if (cellRuns[bj].empty())
+                        continue;
+                    for (int j = corner(bj, ny); j < corner(bj + 1, ny); ++j)
+                        for (size_t r = 0; r < cellRuns[bj].size(); ++r)
+                            march_cell_row(cur, next, xs[i], xs[i + 1], ys, zs, j,
+                                           cellRuns[bj][r].first, cellRuns[bj][r].second,
+                                           isovalue, slabVertices[s]);
+                }
+                std::swap(cur, next);
+            }
+        }
+    });
+    slabVertices.resize(slabs);
 
-                // Determine cube configuration index using bitmasking
+    if (stats) {
+        stats->blocks = active.size();
+        stats->activeBlocks = activeCount;
+        stats->fieldSamples = coarse.size();
+        for (size_t s = 0; s < slabSamples.size(); ++s)
+            stats->fieldSamples += slabSamples[s];
+    }
+    return merge_slabs(slabVertices);
+}
+
+// Flat marching cubes over a pre-sampled lattice of T, one slab per thread.
+template <typename T>
+static std::vector<float> march_lattice(const T* values, const std::vector<float>& xs,
+                                        const std::vector<float>& ys, const std::vector<float>& zs,
+                                        float isovalue, int numThreads) {
+    int nx = (int)xs.size() - 1;
+    std::vector<std::vector<float> > slabVertices(resolve_thread_count(numThreads));
+    int slabs = run_slabs(nx, numThreads, [&](int s, int i0, int i1) {
+        march_lattice_slab(values, xs, ys, zs, isovalue, i0, i1, slabVertices[s]);
+    });
+    slabVertices.resize(slabs);
+    return merge_slabs(slabVertices);
+}
+
+std::vector<float> marching_cubes(const ScalarGrid& grid, float isovalue, int numThreads) {
+    return march_lattice(grid.values.data(), grid.xs, grid.ys, grid.zs, isovalue, numThreads);
+}
+
+TriangleCounts count_triangles(const ScalarGrid& grid, float isovalue, int numThreads) {
+    int nx = (int)grid.xs.size() - 1;
+    int ny = (int)grid.ys.size() - 1;
+    int nz = (int)grid.zs.size() - 1;
+    size_t sliceSize = grid.ys.size() * grid.zs.size();
+
+    TriangleCounts counts;
+    counts.sliceOffsets.assign(nx + 1, 0);
+    counts.cellOffsets.assign(nx + 1, 0);
+    std::vector<std::vector<uint32_t> > slabCells(resolve_thread_count(numThreads));
+    int slabs = run_slabs(nx, numThreads, [&](int s, int i0, int i1) {
+        for (int i = i0; i < i1; ++i) {
+            const float* v0 = grid.values.data() + i * sliceSize;
+            counts.sliceOffsets[i + 1] = count_slice_pair(v0, v0 + sliceSize, ny, nz, isovalue, slabCells[s]);
+            counts.cellOffsets[i + 1] = slabCells[s].size();
+        }
+    });
+
+    // Exclusive prefix sums: slice i starts after everything in the slices before it.
+    // cellOffsets were recorded relative to their slab, so rebase them on the way.
+    size_t slabBase = 0;
+    for (int s = 0; s < slabs; ++s) {
+        int i0 = (int)((long long)nx * s / slabs);
+        int i1 = (int)((long long)nx * (s + 1) / slabs);
+        for (int i = i0; i < i1; ++i)
+            counts.cellOffsets[i + 1] += slabBase;
+        slabBase += slabCells[s].size();
+    }
+    for (int i = 0; i < nx; ++i)
+        counts.sliceOffsets[i + 1] += counts.sliceOffsets[i];
+    counts.total = counts.sliceOffsets[nx];
+
+    counts.cells.reserve(slabBase);
+    for (int s = 0; s < slabs; ++s) {
+        counts.cells.insert(counts.cells.end(), slabCells[s].begin(), slabCells[s].end());
+        std::vector<uint32_t>().swap(slabCells[s]);
+    }
+    return counts;
+}
+
+void marching_cubes_fill(const ScalarGrid& grid, float isovalue, const TriangleCounts& counts,
+                         float* out, int numThreads) {
+    int nx = (int)grid.xs.size() - 1;
+    int nz = (int)grid.zs.size() - 1;
+    size_t sliceSize = grid.ys.size() * grid.zs.size();
+    run_slabs(nx, numThreads, [&](int, int i0, int i1) {
+        // Each slab starts at its own offset, so the slabs never touch the same floats
+        VertexCursor cursor = {out + counts.sliceOffsets[i0] * 9};
+        for (int i = i0; i < i1; ++i) {
+            const float* v0 = grid.values.data() + i * sliceSize;
+            // Only the cells the count pass found, in the same order as march_slice_pair
+            for (size_t c = counts.cellOffsets[i]; c < counts.cellOffsets[i + 1]; ++c) {
+                int j = (int)(counts.cells[c] / nz);
+                int k = (int)(counts.cells[c] % nz);
+                march_cell_row(v0, v0 + sliceSize, grid.xs[i], grid.xs[i + 1],
+                               grid.ys, grid.zs, j, k, k + 1, isovalue, cursor);
+            }
+        }
+    });
+}
+
+std::vector<float> marching_cubes_exact(const ScalarGrid& grid, float isovalue, int numThreads) {
+    TriangleCounts counts = count_triangles(grid, isovalue, numThreads);
+    std::vector<float> vertices(counts.total * 9);
+    marching_cubes_fill(grid, isovalue, counts, vertices.data(), numThreads);
+    return vertices;
+}
+
+MinMaxIndex build_minmax_index(const ScalarGrid& grid, int leafSize, int numThreads) {
+    const int B = leafSize > 0 ? leafSize : 1;
+    const int nx = (int)grid.xs.size() - 1, ny = (int)grid.ys.size() - 1, nz = (int)grid.zs.size() - 1;
+    const size_t sy = grid.zs.size(), sx = grid.ys.size() * grid.zs.size();
+
+    MinMaxIndex index;
+    index.leafSize = B;
+    MinMaxLevel leaves;
+    leaves.nx = (nx + B - 1) / B;
+    leaves.ny = (ny + B - 1) / B;
+    leaves.nz = (nz + B - 1) / B;
+    size_t leafCount = (size_t)leaves.nx * leaves.ny * leaves.nz;
+    leaves.lo.resize(leafCount);
+    leaves.hi.resize(leafCount);
+
+    // Leaf ranges cover every lattice point of their cells, shared faces included
+    run_slabs(leaves.nx, numThreads, [&](int, int b0, int b1) {
+        for (int bi = b0; bi < b1; ++bi)
+            for (int bj = 0; bj < leaves.ny; ++bj)
+                for (int bk = 0; bk < leaves.nz; ++bk) {
+                    int k0 = bk * B, k1 = std::min((bk + 1) * B, nz);
+                    float lo = grid.values[bi * B * sx + bj * B * sy + k0];
+                    float hi = lo;
+                    for (int i = bi * B; i <= std::min((bi + 1) * B, nx); ++i)
+                        for (int j = bj * B; j <= std::min((bj + 1) * B, ny); ++j) {
+                            const float* row = &grid.values[i * sx + j * sy];
+                            for (int k = k0; k <= k1; ++k) {
+                                lo = std::min(lo, row[k]);
+                                hi = std::max(hi, row[k]);
+                            }
+                        }
+                    size_t n = ((size_t)bi * leaves.ny + bj) * leaves.nz + bk;
+                    leaves.lo[n] = lo;
+                    leaves.hi[n] = hi;
+                }
+    });
+    index.levels.push_back(leaves);
+
+    // Merge 2x2x2 nodes until a single root is left
+    while (index.levels.back().lo.size() > 1) {
+        const MinMaxLevel& below = index.levels.back();
+        MinMaxLevel level;
+        level.nx = (below.nx + 1) / 2;
+        level.ny = (below.ny + 1) / 2;
+        level.nz = (below.nz + 1) / 2;
+        level.lo.assign((size_t)level.nx * level.ny * level.nz, 0.0f);
+        level.hi.assign(level.lo.size(), 0.0f);
+        for (int x = 0; x < level.nx; ++x)
+            for (int y = 0; y < level.ny; ++y)
+                for (int z = 0; z < level.nz; ++z) {
+                    bool first = true;
+                    float lo = 0.0f, hi = 0.0f;
+                    for (int cx = 2 * x; cx < std::min(2 * x + 2, below.nx); ++cx)
+                        for (int cy = 2 * y; cy < std::min(2 * y + 2, below.ny); ++cy)
+                            for (int cz = 2 * z; cz < std::min(2 * z + 2, below.nz); ++cz) {
+                                size_t c = ((size_t)cx * below.ny + cy) * below.nz + cz;
+                                lo = first ? below.lo[c] : std::min(lo, below.lo[c]);
+                                hi = first ? below.hi[c] : std::max(hi, below.hi[c]);
+                                first = false;
+                            }
+                    size_t n = ((size_t)x * level.ny + y) * level.nz + z;
+                    level.lo[n] = lo;
+                    level.hi[n] = hi;
+                }
+        index.levels.push_back(level);
+    }
+    return index;
+}
+
+// Leaf blocks of index whose value range straddles isovalue, i.e. that hold at
+// least one cell with corners on both sides, in increasing (x-major) order.
+static std::vector<uint32_t> active_leaves(const MinMaxIndex& index, float isovalue) {
+    std::vector<uint32_t> leaves;
+    if (index.levels.empty() || index.levels[0].lo.empty())
+        return leaves;
+
+    struct Node { int level, x, y, z; };
+    std::vector<Node> stack;
+    Node root = {(int)index.levels.size() - 1, 0, 0, 0};
+    stack.push_back(root);
+    while (!stack.empty()) {
+        Node node = stack.back();
+        stack.pop_back();
+        const MinMaxLevel& level = index.levels[node.level];
+        size_t n = ((size_t)node.x * level.ny + node.y) * level.nz + node.z;
+        // Same test as the cube classification: some corner below, some not
+        if (!(level.lo[n] < isovalue && level.hi[n] >= isovalue))
+            continue;
+        if (node.level == 0) {
+            leaves.push_back((uint32_t)n);
+            continue;
+        }
+        const MinMaxLevel& below = index.levels[node.level - 1];
+        for (int cx = 2 * node.x; cx < std::min(2 * node.x + 2, below.nx); ++cx)
+            for (int cy = 2 * node.y; cy < std::min(2 * node.y + 2, below.ny); ++cy)
+                for (int cz = 2 * node.z; cz < std::min(2 * node.z + 2, below.nz); ++cz) {
+                    Node child = {node.level - 1, cx, cy, cz};
+                    stack.push_back(child);
+                }
+    }
+    std::sort(leaves.begin(), leaves.end());
+    return leaves;
+}
+
+std::vector<float> marching_cubes(const ScalarGrid& grid, const MinMaxIndex& index, float isovalue, int numThreads) {
+    const int B = index.leafSize;
+    const int nx = (int)grid.xs.size() - 1, ny = (int)grid.ys.size() - 1, nz = (int)grid.zs.size() - 1;
+    const MinMaxLevel& leafLevel = index.levels[0];
+    const size_t sliceSize = grid.ys.size() * grid.zs.size();
+    std::vector<uint32_t> leaves = active_leaves(index, isovalue);
+
+    // Start of each x layer of active leaves within the sorted list
+    const size_t layerSize = (size_t)leafLevel.ny * leafLevel.nz;
+    std::vector<size_t> layerStart;
+    for (size_t n = 0; n < leaves.size(); ++n)
+        if (n == 0 || leaves[n] / layerSize != leaves[n - 1] / layerSize)
+            layerStart.push_back(n);
+    layerStart.push_back(leaves.size());
+    int layers = (int)layerStart.size() - 1;
+
+    std::vector<std::vector<float> > slabVertices(resolve_thread_count(numThreads));
+    int slabs = run_slabs(layers, numThreads, [&](int s, int l0, int l1) {
+        // z runs of active cells, one list per leaf row bj, in row order
+        std::vector<int> rows;
+        std::vector<std::vector<std::pair<int, int> > > runs;
+        for (int l = l0; l < l1; ++l) {
+            rows.clear();
+            runs.clear();
+            for (size_t n = layerStart[l]; n < layerStart[l + 1]; ++n) {
+                int bj = (int)(leaves[n] / leafLevel.nz % leafLevel.ny);
+                int bk = (int)(leaves[n] % leafLevel.nz);
+                int k0 = bk * B, k1 = std::min((bk + 1) * B, nz);
+                if (rows.empty() || rows.back() != bj) {
+                    rows.push_back(bj);
+                    runs.push_back(std::vector<std::pair<int, int> >());
+                }
+                if (!runs.back().empty() && runs.back().back().second == k0)
+                    runs.back().back().second = k1;
+                else
+                    runs.back().push_back(std::make_pair(k0, k1));
+            }
+
+            // Cells in the usual x/y/z order, so the output matches marching_cubes(grid)
+            int bi = (int)(leaves[layerStart[l]] / layerSize);
+            for (int i = bi * B; i < std::min((bi + 1) * B, nx); ++i) {
+                const float* v0 = grid.values.data() + i * sliceSize;
+                for (size_t r = 0; r < rows.size(); ++r)
+                    for (int j = rows[r] * B; j < std::min((rows[r] + 1) * B, ny); ++j)
+                        for (size_t q = 0; q < runs[r].size(); ++q)
+                            march_cell_row(v0, v0 + sliceSize, grid.xs[i], grid.xs[i + 1], grid.ys, grid.zs,
+                                           j, runs[r][q].first, runs[r][q].second, isovalue, slabVertices[s]);
+            }
+        }
+    });
+    slabVertices.resize(slabs);
+    return merge_slabs(slabVertices);
+}
+
+// Indexed marching cubes over a field sampled slice by slice.
+template <typename Normals>
+static IndexedMesh march_sampled_indexed(const std::vector<float>& xs, const std::vector<float>& ys,
+                                         const std::vector<float>& zs, float isovalue, int numThreads,
+                                         const mc_detail::SliceSampler& sample, const Normals& normals) {
+    int nx = (int)xs.size() - 1;
+    size_t sliceSize = ys.size() * zs.size();
+
+    std::vector<IndexedSlab> slabs(resolve_thread_count(numThreads));
+    int used = run_slabs(nx, numThreads, [&](int s, int i0, int i1) {
+        // Rolling two-slice cache, as in march_slab
+        std::vector<float> sliceA(sliceSize), sliceB(sliceSize);
+        float* cur = sliceA.data();
+        float* next = sliceB.data();
+        bool primed = false;
+        auto slicePair = [&](int i, const float*& v0, const float*& v1) {
+            if (!primed) {
+                sample(xs[i], cur);
+                primed = true;
+            } else {
+                std::swap(cur, next);
+            }
+            sample(xs[i + 1], next);
+            v0 = cur;
+            v1 = next;
+        };
+        march_indexed_slab<float>(slicePair, xs, ys, zs, isovalue, i0, i1, normals, slabs[s]);
+    });
+    slabs.resize(used);
+    return merge_indexed_slabs(slabs);
+}
+
+IndexedMesh mc_detail::march_slices_indexed(const std::vector<float>& xs, const std::vector<float>& ys,
+                                            const std::vector<float>& zs, float isovalue, int numThreads,
+                                            const SliceSampler& sample) {
+    return march_sampled_indexed(xs, ys, zs, isovalue, numThreads, sample, NoNormals());
+}
+
+// Indexed marching cubes over a pre-sampled lattice of T, with gradient
+// normals if withNormals is set.
+template <typename T>
+static IndexedMesh march_lattice_indexed(const T* values, const std::vector<float>& xs,
+                                         const std::vector<float>& ys, const std::vector<float>& zs,
+                                         float isovalue, int numThreads, bool withNormals = false) {
+    int nx = (int)xs.size() - 1;
+    size_t sliceSize = ys.size() * zs.size();
+
+    std::vector<IndexedSlab> slabs(resolve_thread_count(numThreads));
+    int used = run_slabs(nx, numThreads, [&](int s, int i0, int i1) {
+        auto slicePair = [&](int i, const T*& v0, const T*& v1) {
+            v0 = values + i * sliceSize;
+            v1 = v0 + sliceSize;
+        };
+        if (withNormals) {
+            GridNormals<T> normals(values, xs, ys, zs);
+            march_indexed_slab<T>(slicePair, xs, ys, zs, isovalue, i0, i1, normals, slabs[s]);
+        } else {
+            march_indexed_slab<T>(slicePair, xs, ys, zs, isovalue, i0, i1, NoNormals(), slabs[s]);
+        }
+    });
+    slabs.resize(used);
+    return merge_indexed_slabs(slabs);
+}
+
+IndexedMesh marching_cubes_indexed(const ScalarGrid& grid, float isovalue, int numThreads) {
+    return march_lattice_indexed(grid.values.data(), grid.xs, grid.ys, grid.zs, isovalue, numThreads);
+}
+
+IndexedMesh marching_cubes_indexed_normals(const ScalarGrid& grid, float isovalue, int numThreads) {
+    return march_lattice_indexed(grid.values.data(), grid.xs, grid.ys, grid.zs, isovalue, numThreads, true);
+}
+
+IndexedMesh marching_cubes_indexed_normals(float (*f)(float, float, float), GradientField gradient, float isovalue,
+                                           float min, float max, float stepsize, int numThreads) {
+    float boxMin[3] = {min, min, min};
+    float boxMax[3] = {max, max, max};
+    return marching_cubes_indexed_normals(f, gradient, isovalue, boxMin, boxMax, stepsize, numThreads);
+}
+
+IndexedMesh marching_cubes_indexed_normals(float (*f)(float, float, float), GradientField gradient, float isovalue,
+                                           const float boxMin[3], const float boxMax[3], float stepsize,
+                                           int numThreads) {
+    std::vector<float> xs = mc_detail::lattice_coords(boxMin[0], boxMax[0], stepsize);
+    std::vector<float> ys = mc_detail::lattice_coords(boxMin[1], boxMax[1], stepsize);
+    std::vector<float> zs = mc_detail::lattice_coords(boxMin[2], boxMax[2], stepsize);
+    FieldNormals normals = {f, gradient, stepsize * 0.5f};
+    return march_sampled_indexed(xs, ys, zs, isovalue, numThreads,
+                                 [f, &ys, &zs](float x, float* slice) {
+                                     mc_detail::sample_slice(f, x, ys, zs, slice);
+                                 },
+                                 normals);
+}
+
+std::vector<float> marching_cubes(const VolumeView& volume, float isovalue, int numThreads) {
+    switch (volume.type) {
+    case SAMPLE_UINT8:
+        return march_lattice((const uint8_t*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads);
+    case SAMPLE_UINT16:
+        return march_lattice((const uint16_t*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads);
+    case SAMPLE_FLOAT32:
+        return march_lattice((const float*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads);
+    }
+    return std::vector<float>();
+}
+
+IndexedMesh marching_cubes_indexed(const VolumeView& volume, float isovalue, int numThreads) {
+    switch (volume.type) {
+    case SAMPLE_UINT8:
+        return march_lattice_indexed((const uint8_t*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads);
+    case SAMPLE_UINT16:
+        return march_lattice_indexed((const uint16_t*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads);
+    case SAMPLE_FLOAT32:
+        return march_lattice_indexed((const float*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads);
+    }
+    return IndexedMesh();
+}
+
+IndexedMesh marching_cubes_indexed_normals(const VolumeView& volume, float isovalue, int numThreads) {
+    switch (volume.type) {
+    case SAMPLE_UINT8:
+        return march_lattice_indexed((const uint8_t*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads, true);
+    case SAMPLE_UINT16:
+        return march_lattice_indexed((const uint16_t*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads, true);
+    case SAMPLE_FLOAT32:
+        return march_lattice_indexed((const float*)volume.values, volume.xs, volume.ys, volume.zs, isovalue, numThreads, true);
+    }
+    return IndexedMesh();
+}
+
+// Surface nets over cell layers [i0, i1) of a sampled lattice. Cell vertex IDs
+// are kept for the current and previous layer ([j * nz + k], -1 = no vertex);
+// every slab but the first also places the vertices of layer i0 - 1 so it can
+// close the quads that reach back into it. merge_indexed_slabs then maps those
+// onto the previous slab's copies through firstPlane/lastPlane.
+static void surface_nets_slab(const float* values, const std::vector<float>& xs,
+                              const std::vector<float>& ys, const std::vector<float>& zs,
+                              float isovalue, int i0, int i1, IndexedSlab& slab) {
+    int ny = (int)ys.size() - 1;
+    int nz = (int)zs.size() - 1;
+    int stride = nz + 1;
+    size_t sliceSize = ys.size() * zs.size();
+    std::vector<int> prev(ny * nz, -1), cur(ny * nz, -1);
+
+    int first = i0 > 0 ? i0 - 1 : i0;
+    for (int i = first; i < i1; ++i) {
+        const float* v0 = values + i * sliceSize;
+        const float* v1 = v0 + sliceSize;
+        float x = xs[i], x1 = xs[i + 1];
+        std::fill(cur.begin(), cur.end(), -1);
+
+        for (int j = 0; j < ny; ++j) {
+            float y = ys[j], y1 = ys[j + 1];
+            const float* a0 = v0 + j * stride;
+            const float* a1 = v1 + j * stride;
+            const float* b0 = a0 + stride;
+            const float* b1 = a1 + stride;
+            for (int k = 0; k < nz; ++k) {
+                float corner[8] = {a0[k], a1[k], a1[k + 1], a0[k + 1],
+                                   b0[k], b1[k], b1[k + 1], b0[k + 1]};
                 int cubeIndex = 0;
-                if (values[0] < isovalue) cubeIndex |= 1;
-                if (values[1] < isovalue) cubeIndex |= 2;
-                if (values[2] < isovalue) cubeIndex |= 4;
-                if (values[3] < isovalue) cubeIndex |= 8;
-                if (values[4] < isovalue) cubeIndex |= 16;
-                if (values[5] < isovalue) cubeIndex |= 32;
-                if (values[6] < isovalue) cubeIndex |= 64;
-                if (values[7] < isovalue) cubeIndex |= 128;
-
-                // Get the triangle table for this cube configuration.
-                // Assumes marching_cubes_lut is defined such that each entry is a list of
-                // edge indices (0..11) terminated with -1.
-                int* edgeList = marching_cubes_lut[cubeIndex];
-                if (edgeList[0] == -1)
-                    continue;  // No intersections in this cube
-
-                // For each triangle defined by the table (3 edges per triangle)
-                for (int i = 0; edgeList[i] != -1; i += 3) {
-                    for (int j = 0; j < 3; j++) {
-                        int edgeIndex = edgeList[i + j]; // an edge index (0..11)
-                        // Get the two endpoints (corner indices) of this edge
-                        int c1 = edgeEndpoints[edgeIndex][0];
-                        int c2 = edgeEndpoints[edgeIndex][1];
-                        
-                        // Compute the interpolation factor alpha.
-                        // Guard against division by zero.
-                        float f1 = values[c1];
-                        float f2 = values[c2];
-                        float alpha = 0.5f; // default to midpoint if f2 == f1
+                for (int c = 0; c < 8; ++c)
+                    if (corner[c] < isovalue) cubeIndex |= 1 << c;
+                if (cubeIndex == 0 || cubeIndex == 255)
+                    continue;
+
+                // The cell's vertex is the mean of its edge crossings
+                float z = zs[k], z1 = zs[k + 1];
+                float cornerPos[8][3] = {
+                    {x, y, z}, {x1, y, z}, {x1, y, z1}, {x, y, z1},
+                    {x, y1, z}, {x1, y1, z}, {x1, y1, z1}, {x, y1, z1}
+                };
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                int crossings = 0;
+                for (int e = 0; e < 12; ++e) {
+                    int c1 = edgeEndpoints[e][0];
+                    int c2 = edgeEndpoints[e][1];
+                    if (((cubeIndex >> c1) ^ (cubeIndex >> c2)) & 1) {
+                        float f1 = corner[c1];
+                        float f2 = corner[c2];
+                        float alpha = 0.5f;
                         if (fabs(f2 - f1) > 1e-6)
                             alpha = (isovalue - f1) / (f2 - f1);
-                        
-                        // Interpolate between the two corner positions:
-                        float vx = cornerPos[c1][0] + alpha * (cornerPos[c2][0] - cornerPos[c1][0]);
-                        float vy = cornerPos[c1][1] + alpha * (cornerPos[c2][1] - cornerPos[c1][1]);
-                        float vz = cornerPos[c1][2] + alpha * (cornerPos[c2][2] - cornerPos[c1][2]);
-                        
-                        // Add the interpolated vertex to the vertex list
-                        vertices.push_back(vx);
-                        vertices.push_back(vy);
-                        vertices.push_back(vz);
+                        for (int c = 0; c < 3; ++c)
+                            sum[c] += cornerPos[c1][c] + alpha * (cornerPos[c2][c] - cornerPos[c1][c]);
+                        ++crossings;
                     }
                 }
+                int id = (int)(slab.mesh.vertices.size() / 3);
+                for (int c = 0; c < 3; ++c)
+                    slab.mesh.vertices.push_back(sum[c] / crossings);
+                int cell = j * nz + k;
+                cur[cell] = id;
+                if (i < i0)
+                    continue;
+
+                // One quad per crossed lattice edge leaving the cell's first corner,
+                // joining the four cells around that edge. Quads are wound like the
+                // marching cubes triangles, facing the side where f < isovalue.
+                bool inside = (cubeIndex & 1) != 0;
+                int quads[3][4];
+                int count = 0;
+                if (j > 0 && k > 0 && inside != ((cubeIndex & 2) != 0)) {   // x edge
+                    int q[4] = {id, cur[cell - 1], cur[cell - nz - 1], cur[cell - nz]};
+                    std::copy(q, q + 4, quads[count++]);
+                }
+                if (i > 0 && k > 0 && inside != ((cubeIndex & 16) != 0)) {  // y edge
+                    int q[4] = {id, prev[cell], prev[cell - 1], cur[cell - 1]};
+                    std::copy(q, q + 4, quads[count++]);
+                }
+                if (i > 0 && j > 0 && inside != ((cubeIndex & 8) != 0)) {   // z edge
+                    int q[4] = {id, cur[cell - nz], prev[cell - nz], prev[cell]};
+                    std::copy(q, q + 4, quads[count++]);
+                }
+                for (int q = 0; q < count; ++q) {
+                    int* v = quads[q];
+                    if (inside)
+                        std::swap(v[1], v[3]);
+                    uint32_t tris[6] = {(uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2],
+                                        (uint32_t)v[0], (uint32_t)v[2], (uint32_t)v[3]};
+                    slab.mesh.indices.insert(slab.mesh.indices.end(), tris, tris + 6);
+                }
             }
         }
+
+        if (i == first && i < i0)
+            slab.firstPlane = cur;
+        std::swap(prev, cur);
     }
-    return vertices;
+    slab.lastPlane = prev;
+}
+
+IndexedMesh surface_nets(const ScalarGrid& grid, float isovalue, int numThreads) {
+    int nx = (int)grid.xs.size() - 1;
+    std::vector<IndexedSlab> slabs(resolve_thread_count(numThreads));
+    int used = run_slabs(nx, numThreads, [&](int s, int i0, int i1) {
+        surface_nets_slab(grid.values.data(), grid.xs, grid.ys, grid.zs, isovalue, i0, i1, slabs[s]);
+    });
+    slabs.resize(used);
+    return merge_indexed_slabs(slabs);
+}
+
+std::vector<float> marching_cubes(float (*f)(float, float, float), float isovalue,
+                                    float min, float max, float stepsize) {
+    return marching_cubes(f, isovalue, min, max, stepsize, 1);
+}
+
+// The function-pointer entry points are plain instantiations of the templates
+// in marching_cubes_template.hpp.
+typedef float (*PointField)(float, float, float);
+
+std::vector<float> marching_cubes(float (*f)(float, float, float), float isovalue,
+                                    float min, float max, float stepsize, int numThreads) {
+    return marching_cubes<PointField>(f, isovalue, min, max, stepsize, numThreads);
+}
+
+std::vector<float> marching_cubes(BatchField f, float isovalue,
+                                    float min, float max, float stepsize, int numThreads) {
+    return marching_cubes<BatchField>(f, isovalue, min, max, stepsize, numThreads);
+}
+
+ScalarGrid sample_grid(float (*f)(float, float, float), float min, float max,
+                       float stepsize, int numThreads) {
+    return sample_grid<PointField>(f, min, max, stepsize, numThreads);
+}
+
+ScalarGrid sample_grid(BatchField f, float min, float max, float stepsize, int numThreads) {
+    return sample_grid<BatchField>(f, min, max, stepsize, numThreads);
+}
+
+IndexedMesh marching_cubes_indexed(float (*f)(float, float, float), float isovalue,
+                                   float min, float max, float stepsize, int numThreads) {
+    return marching_cubes_indexed<PointField>(f, isovalue, min, max, stepsize, numThreads);
+}
+
+IndexedMesh marching_cubes_indexed(BatchField f, float isovalue,
+                                   float min, float max, float stepsize, int numThreads) {
+    return marching_cubes_indexed<BatchField>(f, isovalue, min, max, stepsize, numThreads);
+}
+
+std::vector<float> marching_cubes_sparse(float (*f)(float, float, float), float isovalue,
+                                         float min, float max, float stepsize, float lipschitz,
+                                         int blockSize, int numThreads, SparseStats* stats) {
+    return marching_cubes_sparse<PointField>(f, isovalue, min, max, stepsize, lipschitz,
+                                             blockSize, numThreads, stats);
+}
+
+std::vector<float> marching_cubes_sparse(BatchField f, float isovalue,
+                                         float min, float max, float stepsize, float lipschitz,
+                                         int blockSize, int numThreads, SparseStats* stats) {
+    return marching_cubes_sparse<BatchField>(f, isovalue, min, max, stepsize, lipschitz,
+                                             blockSize, numThreads, stats);
+}
+
+void marching_cubes_stream(float (*f)(float, float, float), float isovalue, float min, float max,
+                           float stepsize, size_t batchTriangles, const TriangleSink& sink) {
+    marching_cubes_stream<PointField>(f, isovalue, min, max, stepsize, batchTriangles, sink);
+}
+
+void marching_cubes_stream(BatchField f, float isovalue, float min, float max,
+                           float stepsize, size_t batchTriangles, const TriangleSink& sink) {
+    marching_cubes_stream<BatchField>(f, isovalue, min, max, stepsize, batchTriangles, sink);
 }
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <functional>
+#include <cstddef>
+#include <cstdint>
 
 // Generates a triangle mesh using the marching cubes algorithm.
 // f: scalar field function f(x,y,z)
@@ -11,4 +13,183 @@
 // stepsize: size of each grid cell
 std::vector<float> marching_cubes(float (*f)(float, float, float), float isovalue, float min, float max, float stepsize);
 
+// Same as above, but splits the x range into slabs that are meshed on
+// numThreads worker threads (0 = one per hardware thread). The slab results
+// are concatenated in order, so the output is identical to the serial version.
+// Each slab samples f into a rolling pair of y/z slices, so every lattice point
+// is evaluated once instead of once per adjacent cell.
+std::vector<float> marching_cubes(float (*f)(float, float, float), float isovalue, float min, float max, float stepsize, int numThreads);
+
+// A scalar field sampled once per lattice point. xs/ys/zs hold the lattice
+// coordinates along each axis and values is stored x-major with z varying
+// fastest: values[(i * ys.size() + j) * zs.size() + k] = f(xs[i], ys[j], zs[k]).
+struct ScalarGrid {
+    std::vector<float> xs, ys, zs;
+    std::vector<float> values;
+};
+
+// Evaluates f once at every lattice point of the [min, max]^3 box, using the
+// same lattice as marching_cubes. Sampling is split across numThreads threads.
+ScalarGrid sample_grid(float (*f)(float, float, float), float min, float max, float stepsize, int numThreads);
+
+// Runs marching cubes over a pre-sampled grid. Produces the same triangles as
+// marching_cubes(f, ...) for the grid f was sampled from, without calling f.
+std::vector<float> marching_cubes(const ScalarGrid& grid, float isovalue, int numThreads);
+
+// Triangle counts of a marching cubes pass over a grid, found by classifying
+// the cells without interpolating. sliceOffsets[i] is the index of the first
+// triangle from the cells between x planes i and i + 1; sliceOffsets has one
+// entry per x plane and its last entry equals total.
+// cells lists the cells that produce triangles (j * nz + k within their slice,
+// slice i's starting at cellOffsets[i]) so the fill pass can skip the rest.
+struct TriangleCounts {
+    std::vector<size_t> sliceOffsets;
+    size_t total;
+    std::vector<uint32_t> cells;
+    std::vector<size_t> cellOffsets;
+};
+
+// Two-pass extraction with exact preallocation. count_triangles tells callers
+// how much room the mesh needs (e.g. to size a GL buffer) and marching_cubes_fill
+// then writes the same triangles as marching_cubes(grid, ...) into out, which
+// must hold counts.total * 9 floats. Both passes run on numThreads threads; in
+// the fill pass each slab writes straight to its own offset, so nothing is
+// reallocated or merged. marching_cubes_exact does both into a new vector.
+TriangleCounts count_triangles(const ScalarGrid& grid, float isovalue, int numThreads);
+void marching_cubes_fill(const ScalarGrid& grid, float isovalue, const TriangleCounts& counts, float* out, int numThreads);
+std::vector<float> marching_cubes_exact(const ScalarGrid& grid, float isovalue, int numThreads);
+
+// Min-max octree over a sampled grid, for extracting many isovalues from the
+// same field. The cells are grouped into leaf blocks of leafSize^3; each leaf
+// stores the range of the grid values at its corners, and each level above
+// merges 2x2x2 nodes of the one below, up to a single root. A query descends
+// only into nodes whose range contains the isovalue, so the work per isovalue
+// follows the size of the surface instead of the size of the grid.
+struct MinMaxLevel {
+    int nx, ny, nz;                 // nodes per axis
+    std::vector<float> lo, hi;      // per node, x-major with z fastest
+};
+struct MinMaxIndex {
+    int leafSize;
+    std::vector<MinMaxLevel> levels;  // levels[0] are the leaf blocks, levels.back() the root
+};
+
+// Builds the index for grid (leafSize 8 is a good default). The index only
+// stores value ranges, so it is small next to the grid it was built from.
+MinMaxIndex build_minmax_index(const ScalarGrid& grid, int leafSize, int numThreads);
+
+// Marching cubes over grid, visiting only the leaf blocks of index that can
+// contain the isovalue. Produces the same triangles as marching_cubes(grid, ...).
+std::vector<float> marching_cubes(const ScalarGrid& grid, const MinMaxIndex& index, float isovalue, int numThreads);
+
+// A triangle mesh with shared vertices: vertices holds x, y, z per vertex and
+// each group of 3 indices is one triangle. normals holds a unit normal per
+// vertex when the extractor was asked for them, and is empty otherwise.
+struct IndexedMesh {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<float> normals;
+};
+
+// Marching cubes with welded output. Every lattice edge crossed by the surface
+// gets exactly one vertex, shared by all the cells (and triangles) touching it.
+// The result does not depend on numThreads.
+IndexedMesh marching_cubes_indexed(float (*f)(float, float, float), float isovalue, float min, float max, float stepsize, int numThreads);
+IndexedMesh marching_cubes_indexed(const ScalarGrid& grid, float isovalue, int numThreads);
+
+// Gradient of a field at (x, y, z), written to g[0..2].
+typedef void (*GradientField)(float x, float y, float z, float* g);
+
+// marching_cubes_indexed that also fills mesh.normals, computed as each vertex
+// is placed rather than in a pass over the finished mesh. The normal is the
+// normalized field gradient, which points the same way as the triangle winding.
+// On a grid (or volume) the gradient is taken by central differences at the two
+// lattice points of the vertex's edge and interpolated like the position. With
+// a field it is gradient(x, y, z) at the vertex, or central differences of f
+// half a step either side when gradient is null; these depend only on the
+// vertex position, so meshes of neighbouring boxes (see the box overload of
+// marching_cubes_indexed) shade without seams.
+IndexedMesh marching_cubes_indexed_normals(const ScalarGrid& grid, float isovalue, int numThreads);
+IndexedMesh marching_cubes_indexed_normals(float (*f)(float, float, float), GradientField gradient, float isovalue, float min, float max, float stepsize, int numThreads);
+IndexedMesh marching_cubes_indexed_normals(float (*f)(float, float, float), GradientField gradient, float isovalue, const float boxMin[3], const float boxMax[3], float stepsize, int numThreads);
+
+// Naive surface nets, a lighter alternative to marching_cubes_indexed for
+// previews and collision meshes. Every cell the surface passes through gets one
+// vertex, at the mean of the cell's edge crossings, and every lattice edge the
+// surface crosses becomes a quad (two triangles) joining the four cells around
+// it. At the same step the triangle count is close to marching cubes, but
+// there are no slivers and the surface is smoother (and less exact at sharp
+// features), so a coarser step is usually enough for the same use. The result
+// does not depend on numThreads. A field can be meshed with
+// surface_nets(sample_grid(f, ...), ...).
+IndexedMesh surface_nets(const ScalarGrid& grid, float isovalue, int numThreads);
+
+// Sample types a VolumeView can hold.
+enum SampleType { SAMPLE_UINT8, SAMPLE_UINT16, SAMPLE_FLOAT32 };
+
+// A sampled lattice stored elsewhere, e.g. a memory-mapped volume file (see
+// volume.h). values is laid out like ScalarGrid.values (x-major, z fastest) and
+// holds xs.size() * ys.size() * zs.size() samples of the given type.
+struct VolumeView {
+    const void* values;
+    SampleType type;
+    std::vector<float> xs, ys, zs;
+};
+
+// Marching cubes over a VolumeView. The cube corners are read straight from
+// volume.values and converted to float as they are used; no copy of the
+// samples is made.
+std::vector<float> marching_cubes(const VolumeView& volume, float isovalue, int numThreads);
+IndexedMesh marching_cubes_indexed(const VolumeView& volume, float isovalue, int numThreads);
+IndexedMesh marching_cubes_indexed_normals(const VolumeView& volume, float isovalue, int numThreads);
+
+// Batched field interface: evaluates f(x, y, zs[k]) for k in [0, count) into
+// out[k]. A row runs along z because that is the contiguous axis of the
+// sampled y/z slices, so one call fills one row of a slice and the field can
+// hoist everything that depends only on (x, y) and vectorize over z.
+typedef void (*BatchField)(float x, float y, const float* zs, int count, float* out);
+
+// Batched counterparts of the entry points above. They sample the same lattice
+// one row per call instead of one point per call.
+std::vector<float> marching_cubes(BatchField f, float isovalue, float min, float max, float stepsize, int numThreads);
+ScalarGrid sample_grid(BatchField f, float min, float max, float stepsize, int numThreads);
+IndexedMesh marching_cubes_indexed(BatchField f, float isovalue, float min, float max, float stepsize, int numThreads);
+
+// Work counters reported by marching_cubes_sparse.
+struct SparseStats {
+    size_t blocks;         // blocks the box was divided into
+    size_t activeBlocks;   // blocks that could not be ruled out and were refined
+    size_t fieldSamples;   // field evaluations, coarse and fine
+};
+
+// Marching cubes with empty-space skipping. The lattice is divided into blocks
+// of blockSize^3 cells (8 or 16 work well) and the field is first sampled at the
+// block corners only. lipschitz must bound |grad f| over the box; with it, a
+// block whose corner values are too far from the isovalue to reach it anywhere
+// inside is skipped without sampling its interior. The remaining blocks are
+// meshed cell by cell. When the bound holds, the output equals marching_cubes.
+// stats may be null.
+std::vector<float> marching_cubes_sparse(float (*f)(float, float, float), float isovalue, float min, float max, float stepsize, float lipschitz, int blockSize, int numThreads, SparseStats* stats);
+std::vector<float> marching_cubes_sparse(BatchField f, float isovalue, float min, float max, float stepsize, float lipschitz, int blockSize, int numThreads, SparseStats* stats);
+
+// Receives count triangles from a streaming extraction: triangles holds 9 floats
+// (three x, y, z corners) per triangle and is only valid during the call.
+typedef std::function<void(const float* triangles, size_t count)> TriangleSink;
+
+// Streaming marching cubes for grids whose mesh does not fit in memory. The
+// triangles of marching_cubes(f, ...) are passed to sink in the same order, in
+// batches of batchTriangles (the last batch may be smaller), instead of being
+// collected into one vector. Only two y/z slices of samples and about one
+// batch of triangles are held at a time. Runs on the calling thread, which is
+// also the thread sink is called on.
+void marching_cubes_stream(float (*f)(float, float, float), float isovalue, float min, float max, float stepsize, size_t batchTriangles, const TriangleSink& sink);
+void marching_cubes_stream(BatchField f, float isovalue, float min, float max, float stepsize, size_t batchTriangles, const TriangleSink& sink);
+
+// Returns numThreads, or the hardware thread count if numThreads <= 0.
+int resolve_thread_count(int numThreads);
+
+// marching_cubes<Field>, marching_cubes_indexed<Field>, marching_cubes_sparse<Field>,
+// marching_cubes_stream<Field> and sample_grid<Field> for arbitrary callables (lambdas, functors), so the field can be inlined.
+#include "marching_cubes_template.hpp"
+
 #endif // MARCHING_CUBES_H
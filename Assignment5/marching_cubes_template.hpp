@@ -0,0 +1,154 @@
+#ifndef MARCHING_CUBES_TEMPLATE_HPP
+#define MARCHING_CUBES_TEMPLATE_HPP
+
+// Header-only marching cubes entry points for any callable field.
+// Included at the end of marching_cubes.h; do not include it on its own.
+//
+// Only the sampling loop depends on the field, so that is the part compiled
+// per Field type: f is called directly (and can be inlined and constant-folded)
+// while filling each y/z slice. Classification, interpolation and threading
+// live in marching_cubes.cpp and are reached through one indirect call per
+// slice. f must be safe to call from several threads at once.
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace mc_detail {
+
+// Fills slice[j * zs.size() + k] with the field at (x, ys[j], zs[k]).
+typedef std::function<void(float x, float* slice)> SliceSampler;
+
+// Fills out[0 .. k1-k0) with the field at (x, y, zs[k0 .. k1)).
+typedef std::function<void(float x, float y, int k0, int k1, float* out)> RowSampler;
+
+std::vector<float> lattice_coords(float min, float max, float stepsize);
+
+std::vector<float> march_slices(const std::vector<float>& xs, const std::vector<float>& ys,
+                                const std::vector<float>& zs, float isovalue, int numThreads,
+                                const SliceSampler& sample);
+
+IndexedMesh march_slices_indexed(const std::vector<float>& xs, const std::vector<float>& ys,
+                                 const std::vector<float>& zs, float isovalue, int numThreads,
+                                 const SliceSampler& sample);
+
+ScalarGrid sample_slices(const std::vector<float>& xs, const std::vector<float>& ys,
+                         const std::vector<float>& zs, int numThreads, const SliceSampler& sample);
+
+std::vector<float> march_sparse(const std::vector<float>& xs, const std::vector<float>& ys,
+                                const std::vector<float>& zs, float isovalue, float lipschitz,
+                                int blockSize, int numThreads, const RowSampler& sampleRow,
+                                SparseStats* stats);
+
+void march_stream(const std::vector<float>& xs, const std::vector<float>& ys,
+                  const std::vector<float>& zs, float isovalue, size_t batchTriangles,
+                  const SliceSampler& sample, const TriangleSink& sink);
+
+// Samples a point-at-a-time field f(x, y, z) on the y/z lattice plane at x.
+template <typename Field>
+inline void sample_slice(const Field& f, float x, const std::vector<float>& ys,
+                         const std::vector<float>& zs, float* slice) {
+    size_t nz = zs.size();
+    for (size_t j = 0; j < ys.size(); ++j) {
+        float y = ys[j];
+        float* row = slice + j * nz;
+        for (size_t k = 0; k < nz; ++k)
+            row[k] = f(x, y, zs[k]);
+    }
+}
+
+// Same, one z row per call of a batched field.
+inline void sample_slice(BatchField f, float x, const std::vector<float>& ys,
+                         const std::vector<float>& zs, float* slice) {
+    size_t nz = zs.size();
+    for (size_t j = 0; j < ys.size(); ++j)
+        f(x, ys[j], zs.data(), (int)nz, slice + j * nz);
+}
+
+// Samples part of one z row, for the sparse extractor.
+template <typename Field>
+inline void sample_row(const Field& f, float x, float y, const std::vector<float>& zs,
+                       int k0, int k1, float* out) {
+    for (int k = k0; k < k1; ++k)
+        out[k - k0] = f(x, y, zs[k]);
+}
+
+inline void sample_row(BatchField f, float x, float y, const std::vector<float>& zs,
+                       int k0, int k1, float* out) {
+    f(x, y, zs.data() + k0, k1 - k0, out);
+}
+
+} // namespace mc_detail
+
+// Flat triangle soup, identical to the function-pointer version for the same field.
+template <typename Field>
+std::vector<float> marching_cubes(Field f, float isovalue, float min, float max, float stepsize, int numThreads = 1) {
+    std::vector<float> coords = mc_detail::lattice_coords(min, max, stepsize);
+    return mc_detail::march_slices(coords, coords, coords, isovalue, numThreads,
+                                   [&f, &coords](float x, float* slice) {
+                                       mc_detail::sample_slice(f, x, coords, coords, slice);
+                                   });
+}
+
+// Welded vertices plus uint32 indices, see marching_cubes_indexed in marching_cubes.h.
+template <typename Field>
+IndexedMesh marching_cubes_indexed(Field f, float isovalue, float min, float max, float stepsize, int numThreads = 1) {
+    std::vector<float> coords = mc_detail::lattice_coords(min, max, stepsize);
+    return mc_detail::march_slices_indexed(coords, coords, coords, isovalue, numThreads,
+                                           [&f, &coords](float x, float* slice) {
+                                               mc_detail::sample_slice(f, x, coords, coords, slice);
+                                           });
+}
+
+// Same as above over the box [boxMin, boxMax] (x, y, z) instead of a cube, with
+// the lattice starting at boxMin on each axis. Boxes that share a face sample it
+// at the same points when the step is exact in binary (e.g. 0.25 on a grid of
+// whole-unit boxes), so their meshes meet without gaps.
+template <typename Field>
+IndexedMesh marching_cubes_indexed(Field f, float isovalue, const float boxMin[3], const float boxMax[3],
+                                   float stepsize, int numThreads = 1) {
+    std::vector<float> xs = mc_detail::lattice_coords(boxMin[0], boxMax[0], stepsize);
+    std::vector<float> ys = mc_detail::lattice_coords(boxMin[1], boxMax[1], stepsize);
+    std::vector<float> zs = mc_detail::lattice_coords(boxMin[2], boxMax[2], stepsize);
+    return mc_detail::march_slices_indexed(xs, ys, zs, isovalue, numThreads,
+                                           [&f, &ys, &zs](float x, float* slice) {
+                                               mc_detail::sample_slice(f, x, ys, zs, slice);
+                                           });
+}
+
+// Samples f once per lattice point of [min, max]^3 into a ScalarGrid.
+template <typename Field>
+ScalarGrid sample_grid(Field f, float min, float max, float stepsize, int numThreads = 1) {
+    std::vector<float> coords = mc_detail::lattice_coords(min, max, stepsize);
+    return mc_detail::sample_slices(coords, coords, coords, numThreads,
+                                    [&f, &coords](float x, float* slice) {
+                                        mc_detail::sample_slice(f, x, coords, coords, slice);
+                                    });
+}
+
+// Empty-space skipping extractor, see marching_cubes_sparse in marching_cubes.h.
+template <typename Field>
+std::vector<float> marching_cubes_sparse(Field f, float isovalue, float min, float max, float stepsize,
+                                         float lipschitz, int blockSize = 8, int numThreads = 1,
+                                         SparseStats* stats = nullptr) {
+    std::vector<float> coords = mc_detail::lattice_coords(min, max, stepsize);
+    return mc_detail::march_sparse(coords, coords, coords, isovalue, lipschitz, blockSize, numThreads,
+                                   [&f, &coords](float x, float y, int k0, int k1, float* out) {
+                                       mc_detail::sample_row(f, x, y, coords, k0, k1, out);
+                                   },
+                                   stats);
+}
+
+// Streaming extractor, see marching_cubes_stream in marching_cubes.h.
+template <typename Field>
+void marching_cubes_stream(Field f, float isovalue, float min, float max, float stepsize,
+                           size_t batchTriangles, const TriangleSink& sink) {
+    std::vector<float> coords = mc_detail::lattice_coords(min, max, stepsize);
+    mc_detail::march_stream(coords, coords, coords, isovalue, batchTriangles,
+                            [&f, &coords](float x, float* slice) {
+                                mc_detail::sample_slice(f, x, coords, coords, slice);
+                            },
+                            sink);
+}
+
+#endif // MARCHING_CUBES_TEMPLATE_HPP
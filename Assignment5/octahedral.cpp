@@ -0,0 +1,60 @@
+#include "octahedral.h"
+#include <cmath>
+
+// -1 for negative x, else 1 (unlike a plain sign, never 0)
+static float sign_not_zero(float x) {
+    return x < 0.0f ? -1.0f : 1.0f;
+}
+
+static int16_t to_snorm16(float x) {
+    if (x > 1.0f) x = 1.0f;
+    if (x < -1.0f) x = -1.0f;
+    // Round half away from zero
+    return (int16_t)(x * 32767.0f + (x < 0.0f ? -0.5f : 0.5f));
+}
+
+void octahedral_encode(const float n[3], int16_t e[2]) {
+    float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (!(l1 > 0.0f)) {
+        e[0] = e[1] = 0;
+        return;
+    }
+    float inv = 1.0f / l1;
+    float u = n[0] * inv;
+    float v = n[1] * inv;
+    if (n[2] < 0.0f) {
+        // Fold the lower half over the diagonals of the square
+        float fu = (1.0f - std::fabs(v)) * sign_not_zero(u);
+        float fv = (1.0f - std::fabs(u)) * sign_not_zero(v);
+        u = fu;
+        v = fv;
+    }
+    e[0] = to_snorm16(u);
+    e[1] = to_snorm16(v);
+}
+
+void octahedral_decode(const int16_t e[2], float n[3]) {
+    float u = std::fmax(e[0] / 32767.0f, -1.0f);
+    float v = std::fmax(e[1] / 32767.0f, -1.0f);
+    float x = u, y = v, z = 1.0f - std::fabs(u) - std::fabs(v);
+    if (z < 0.0f) {
+        x = (1.0f - std::fabs(v)) * sign_not_zero(u);
+        y = (1.0f - std::fabs(u)) * sign_not_zero(v);
+    }
+    float length = std::sqrt(x * x + y * y + z * z);
+    n[0] = x / length;
+    n[1] = y / length;
+    n[2] = z / length;
+}
+
+std::vector<PackedVertex> pack_vertices(const std::vector<float>& positions, const std::vector<float>& normals) {
+    std::vector<PackedVertex> mesh(positions.size() / 3);
+    for (size_t i = 0; i < mesh.size(); ++i) {
+        PackedVertex& v = mesh[i];
+        v.x = positions[i * 3 + 0];
+        v.y = positions[i * 3 + 1];
+        v.z = positions[i * 3 + 2];
+        octahedral_encode(&normals[i * 3], v.n);
+    }
+    return mesh;
+}
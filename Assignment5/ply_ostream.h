@@ -0,0 +1,33 @@
+#ifndef PLY_OSTREAM_H
+#define PLY_OSTREAM_H
+
+#include <fstream>
+#include <vector>
+#include "marching_cubes.h" // IndexedMesh
+
+// The indexed PLY writer as it was before the buffered writePLY: every value
+// goes through ofstream <<. The benchmark times writePLY against it and the
+// checks compare their ASCII output byte for byte.
+inline void write_ply_ostream(const IndexedMesh& mesh, const std::vector<float>& normals, const char* fileName) {
+    std::ofstream outFile(fileName);
+    outFile << "ply\n";
+    outFile << "format ascii 1.0\n";
+    outFile << "element vertex " << mesh.vertices.size() / 3 << "\n";
+    outFile << "property float x\n";
+    outFile << "property float y\n";
+    outFile << "property float z\n";
+    outFile << "property float nx\n";
+    outFile << "property float ny\n";
+    outFile << "property float nz\n";
+    outFile << "element face " << mesh.indices.size() / 3 << "\n";
+    outFile << "property list uchar int vertex_indices\n";
+    outFile << "end_header\n";
+    for (size_t i = 0; i < mesh.vertices.size(); i += 3) {
+        outFile << mesh.vertices[i] << " " << mesh.vertices[i+1] << " " << mesh.vertices[i+2] << " "
+                << normals[i] << " " << normals[i+1] << " " << normals[i+2] << "\n";
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        outFile << "3 " << mesh.indices[i] << " " << mesh.indices[i + 1] << " " << mesh.indices[i + 2] << "\n";
+}
+
+#endif // PLY_OSTREAM_H
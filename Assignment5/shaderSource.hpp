@@ -6,7 +6,7 @@ const char* vertexShaderSource = R"(
 #version 120
 
 attribute vec3 aPos;
-attribute vec3 aNormal;
+attribute vec3 aNormal;   // or, with packedNormals, an octahedral normal in .xy
 
 // Required uniforms
 uniform mat4 MVP;          // Model-View-Projection matrix
@@ -14,12 +14,25 @@ uniform mat4 M;            // Model matrix
 uniform mat3 normalMatrix; // transpose(inverse(M))
 uniform mat4 V;            // View matrix
 uniform vec3 LightDir;     // Light direction in world space
+uniform bool packedNormals; // aNormal holds 2 snorm16 components (octahedral.h)
 
 // Varyings for the fragment shader
 varying vec3 vFragPos;  
 varying vec3 vNormal;
 varying vec3 vLightDir;
 
+// Unfolds an octahedral encoding. GL 2.1 normalizes the shorts as (2c + 1) / 65535,
+// not octahedral_decode's c / 32767, so the result is within about 0.01 degrees of it.
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 s = vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(e.yx)) * s;
+    }
+    return normalize(n);
+}
+
 void main()
 {
     // Final clip-space position
@@ -31,7 +44,8 @@ void main()
 
     // Transform the normal into world space
     // (normalMatrix is typically transpose(inverse(M)), so it does that job.)
-    vNormal = normalize(normalMatrix * aNormal);
+    vec3 normal = packedNormals ? octahedralDecode(aNormal.xy) : aNormal;
+    vNormal = normalize(normalMatrix * normal);
 
     // Pass the light direction to the fragment shader.
     // If LightDir is already the direction from the fragment to the light (in world space),
@@ -0,0 +1,191 @@
+#include "volume.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const size_t VOLUME_HEADER_SIZE = 64;
+
+static size_t sample_size(SampleType type) {
+    switch (type) {
+    case SAMPLE_UINT8: return 1;
+    case SAMPLE_UINT16: return 2;
+    case SAMPLE_FLOAT32: return 4;
+    }
+    return 0;
+}
+
+// Header fields are little-endian regardless of the host byte order.
+static uint32_t read_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void write_le32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)((v >> 8) & 0xff);
+    p[2] = (unsigned char)((v >> 16) & 0xff);
+    p[3] = (unsigned char)((v >> 24) & 0xff);
+}
+
+static float read_lef(const unsigned char* p) {
+    uint32_t bits = read_le32(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void write_lef(unsigned char* p, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    write_le32(p, bits);
+}
+
+static bool host_is_little_endian() {
+    uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+MappedVolume::MappedVolume() : mapping(nullptr), mappingSize(0) {
+    volume.values = nullptr;
+    volume.type = SAMPLE_FLOAT32;
+}
+
+MappedVolume::~MappedVolume() {
+    close();
+}
+
+bool MappedVolume::open(const std::string& fileName) {
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to open volume " << fileName << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < VOLUME_HEADER_SIZE) {
+        std::cerr << "Error: " << fileName << " is too small to be a volume file" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size_t fileSize = (size_t)info.st_size;
+    void* base = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file referenced
+    if (base == MAP_FAILED) {
+        std::cerr << "Error: Unable to map volume " << fileName << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = (const unsigned char*)base;
+    uint32_t type = read_le32(header + 4);
+    uint32_t dims[3] = {read_le32(header + 8), read_le32(header + 12), read_le32(header + 16)};
+    size_t samples = (size_t)dims[0] * dims[1] * dims[2];
+    const char* problem = nullptr;
+    if (std::memcmp(header, "MCV1", 4) != 0)
+        problem = "bad magic number";
+    else if (type > SAMPLE_FLOAT32)
+        problem = "unknown sample type";
+    else if (dims[0] < 2 || dims[1] < 2 || dims[2] < 2)
+        problem = "needs at least 2 points along each axis";
+    else if (fileSize < VOLUME_HEADER_SIZE + samples * sample_size((SampleType)type))
+        problem = "file is shorter than its header says";
+    else if (type != SAMPLE_UINT8 && !host_is_little_endian())
+        problem = "multi-byte samples need a little-endian host";
+    if (problem) {
+        std::cerr << "Error: " << fileName << ": " << problem << std::endl;
+        munmap(base, fileSize);
+        return false;
+    }
+
+    // Slabs are read front to back; let the OS read ahead
+    madvise(base, fileSize, MADV_SEQUENTIAL);
+
+    mapping = base;
+    mappingSize = fileSize;
+    volume.type = (SampleType)type;
+    volume.values = header + VOLUME_HEADER_SIZE;
+    std::vector<float>* coords[3] = {&volume.xs, &volume.ys, &volume.zs};
+    for (int axis = 0; axis < 3; ++axis) {
+        float spacing = read_lef(header + 20 + axis * 4);
+        float origin = read_lef(header + 32 + axis * 4);
+        coords[axis]->resize(dims[axis]);
+        for (uint32_t i = 0; i < dims[axis]; ++i)
+            (*coords[axis])[i] = origin + i * spacing;
+    }
+    return true;
+}
+
+void MappedVolume::close() {
+    if (mapping)
+        munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    volume.values = nullptr;
+    volume.xs.clear();
+    volume.ys.clear();
+    volume.zs.clear();
+}
+
+// Range of count samples of type T, skipping NaNs.
+template <typename T>
+static void sample_range(const T* values, size_t count, float& lo, float& hi) {
+    for (size_t i = 0; i < count; ++i) {
+        float v = (float)values[i];
+        if (v == v) {
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+    }
+}
+
+void MappedVolume::valueRange(float& lo, float& hi) const {
+    lo = INFINITY;
+    hi = -INFINITY;
+    size_t count = volume.xs.size() * volume.ys.size() * volume.zs.size();
+    switch (volume.type) {
+    case SAMPLE_UINT8: sample_range((const uint8_t*)volume.values, count, lo, hi); break;
+    case SAMPLE_UINT16: sample_range((const uint16_t*)volume.values, count, lo, hi); break;
+    case SAMPLE_FLOAT32: sample_range((const float*)volume.values, count, lo, hi); break;
+    }
+    if (lo > hi)
+        lo = hi = 0.0f;  // empty or all-NaN
+}
+
+bool write_raw_volume(const std::string& fileName, SampleType type, int nx, int ny, int nz,
+                      const float spacing[3], const float origin[3], const void* samples) {
+    if (type != SAMPLE_UINT8 && !host_is_little_endian()) {
+        std::cerr << "Error: multi-byte samples need a little-endian host" << std::endl;
+        return false;
+    }
+    std::ofstream outFile(fileName.c_str(), std::ios::binary);
+    if (!outFile.is_open()) {
+        std::cerr << "Error: Unable to open file " << fileName << " for writing." << std::endl;
+        return false;
+    }
+
+    unsigned char header[VOLUME_HEADER_SIZE] = {0};
+    std::memcpy(header, "MCV1", 4);
+    write_le32(header + 4, (uint32_t)type);
+    write_le32(header + 8, (uint32_t)nx);
+    write_le32(header + 12, (uint32_t)ny);
+    write_le32(header + 16, (uint32_t)nz);
+    for (int axis = 0; axis < 3; ++axis) {
+        write_lef(header + 20 + axis * 4, spacing[axis]);
+        write_lef(header + 32 + axis * 4, origin[axis]);
+    }
+    outFile.write((const char*)header, VOLUME_HEADER_SIZE);
+    outFile.write((const char*)samples, (std::streamsize)((size_t)nx * ny * nz * sample_size(type)));
+    if (!outFile) {
+        std::cerr << "Error: Failed while writing " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
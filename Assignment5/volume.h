@@ -0,0 +1,53 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <string>
+#include "marching_cubes.h"
+
+// Raw volume files (CT/MRI style sampled data). A 64-byte little-endian header
+// is followed directly by the samples:
+//
+//   offset  type        field
+//   0       char[4]     magic "MCV1"
+//   4       uint32      sample type: 0 = uint8, 1 = uint16, 2 = float32
+//   8       uint32[3]   nx, ny, nz: lattice points along x, y, z
+//   20      float32[3]  spacing between points along x, y, z
+//   32      float32[3]  position of the first point
+//   44      -           zero padding up to 64
+//
+// Samples are stored x-major with z varying fastest (the ScalarGrid layout),
+// little-endian. Point (i, j, k) lies at origin + (i, j, k) * spacing.
+
+// A read-only memory mapping of a raw volume file. marching_cubes(view(), ...)
+// reads cell corners straight from the mapped pages, so a volume larger than
+// the available heap can be meshed; the OS pages it in as the slabs advance.
+class MappedVolume {
+public:
+    MappedVolume();
+    ~MappedVolume();
+
+    // Maps fileName and checks its header. Prints an error and returns false on failure.
+    bool open(const std::string& fileName);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    // Lattice description pointing into the mapping; valid while the file stays open.
+    const VolumeView& view() const { return volume; }
+    // Smallest and largest sample in the file (one pass over the mapping).
+    void valueRange(float& lo, float& hi) const;
+
+private:
+    MappedVolume(const MappedVolume&);
+    MappedVolume& operator=(const MappedVolume&);
+
+    void* mapping;
+    size_t mappingSize;
+    VolumeView volume;
+};
+
+// Writes nx * ny * nz samples of the given type (laid out as above) to a raw
+// volume file. Prints an error and returns false on failure.
+bool write_raw_volume(const std::string& fileName, SampleType type, int nx, int ny, int nz,
+                      const float spacing[3], const float origin[3], const void* samples);
+
+#endif // VOLUME_H
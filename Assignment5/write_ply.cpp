@@ -1,42 +1,246 @@
 #include "write_ply.h"
+#include "compute_normals.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
 
-void writePLY(const std::vector<float>& vertices, const std::vector<float>& normals, const std::string& fileName) {
-    std::ofstream outFile(fileName);
-    if (!outFile.is_open()){
+// Width of the zero-padded element counts in a streamed header
+static const int PLY_COUNT_DIGITS = 10;
+
+// Stores a 32-bit value little-endian regardless of the host byte order.
+static char* put_le32(char* dst, uint32_t bits) {
+    dst[0] = (char)(bits & 0xff);
+    dst[1] = (char)((bits >> 8) & 0xff);
+    dst[2] = (char)((bits >> 16) & 0xff);
+    dst[3] = (char)((bits >> 24) & 0xff);
+    return dst + 4;
+}
+
+static char* put_float(char* dst, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return put_le32(dst, bits);
+}
+
+// Output buffer for the PLY writers: callers reserve room, fill it and
+// commit; full buffers go to the file with one fwrite each.
+class PLYFileBuffer {
+public:
+    PLYFileBuffer(FILE* file, size_t capacity) : file(file), data(capacity), used(0) {}
+
+    // Returns room for at least n bytes (n must not exceed the capacity).
+    char* reserve(size_t n) {
+        if (used + n > data.size())
+            flush();
+        return data.data() + used;
+    }
+    void commit(const char* end) { used = end - data.data(); }
+    void write(const char* text) {
+        size_t n = std::strlen(text);
+        commit((char*)std::memcpy(reserve(n), text, n) + n);
+    }
+    void flush() {
+        if (used > 0)
+            std::fwrite(data.data(), 1, used, file);
+        used = 0;
+    }
+
+private:
+    FILE* file;
+    std::vector<char> data;
+    size_t used;
+};
+
+// Appends value as ostream << value would print it (%g, 6 significant digits).
+static char* put_ascii(char* dst, float value) {
+    return std::to_chars(dst, dst + 32, value, std::chars_format::general, 6).ptr;
+}
+
+static char* put_ascii(char* dst, uint64_t value) {
+    return std::to_chars(dst, dst + 32, value).ptr;
+}
+
+// Writes the mesh in the given format. Face f uses indices[3f .. 3f + 2], or
+// the vertices 3f .. 3f + 2 when indices is null (a flat triangle soup).
+static void write_ply(const float* vertices, const float* normals, size_t vertexCount,
+                      const uint32_t* indices, size_t faceCount, const std::string& fileName,
+                      PLYFormat format) {
+    FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (!file) {
         std::cerr << "Error: Unable to open file " << fileName << " for writing." << std::endl;
         return;
     }
-    int vertexCount = vertices.size() / 3;
-    int faceCount = vertices.size() / 9;
-    
+    PLYFileBuffer out(file, 1 << 20);
+
     // Write header
-    outFile << "ply\n";
-    outFile << "format ascii 1.0\n";
-    outFile << "element vertex " << vertexCount << "\n";
-    outFile << "property float x\n";
-    outFile << "property float y\n";
-    outFile << "property float z\n";
-    outFile << "property float nx\n";
-    outFile << "property float ny\n";
-    outFile << "property float nz\n";
-    outFile << "element face " << faceCount << "\n";
-    outFile << "property list uchar int vertex_indices\n";
-    outFile << "end_header\n";
-    
-    // Write vertices and normals
-    for (size_t i = 0; i < vertices.size(); i += 3) {
-        outFile << vertices[i] << " " << vertices[i+1] << " " << vertices[i+2] << " "
-                << normals[i] << " " << normals[i+1] << " " << normals[i+2] << "\n";
-    }
-    
-    // Write face indices (each face uses 3 consecutive vertices)
-    for (int i = 0; i < faceCount; ++i) {
-        outFile << "3 " << i*3 << " " << i*3 + 1 << " " << i*3 + 2 << "\n";
-    }
-    outFile.close();
+    char line[64];
+    out.write("ply\n");
+    out.write(format == PLY_BINARY ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
+    snprintf(line, sizeof(line), "element vertex %llu\n", (unsigned long long)vertexCount);
+    out.write(line);
+    out.write("property float x\n");
+    out.write("property float y\n");
+    out.write("property float z\n");
+    out.write("property float nx\n");
+    out.write("property float ny\n");
+    out.write("property float nz\n");
+    snprintf(line, sizeof(line), "element face %llu\n", (unsigned long long)faceCount);
+    out.write(line);
+    out.write("property list uchar int vertex_indices\n");
+    out.write("end_header\n");
+
+    // Write vertices and normals: 6 floats each, at most 6 * 16 characters in ASCII
+    for (size_t i = 0; i < vertexCount * 3; i += 3) {
+        char* dst = out.reserve(6 * 16);
+        if (format == PLY_BINARY) {
+            dst = put_float(dst, vertices[i]);
+            dst = put_float(dst, vertices[i + 1]);
+            dst = put_float(dst, vertices[i + 2]);
+            dst = put_float(dst, normals[i]);
+            dst = put_float(dst, normals[i + 1]);
+            dst = put_float(dst, normals[i + 2]);
+        } else {
+            dst = put_ascii(dst, vertices[i]);
+            *dst++ = ' ';
+            dst = put_ascii(dst, vertices[i + 1]);
+            *dst++ = ' ';
+            dst = put_ascii(dst, vertices[i + 2]);
+            *dst++ = ' ';
+            dst = put_ascii(dst, normals[i]);
+            *dst++ = ' ';
+            dst = put_ascii(dst, normals[i + 1]);
+            *dst++ = ' ';
+            dst = put_ascii(dst, normals[i + 2]);
+            *dst++ = '\n';
+        }
+        out.commit(dst);
+    }
+
+    // Write faces, each a count of 3 and three vertex indices
+    for (size_t f = 0; f < faceCount; ++f) {
+        uint32_t corner[3];
+        for (int c = 0; c < 3; ++c)
+            corner[c] = indices ? indices[f * 3 + c] : (uint32_t)(f * 3 + c);
+        char* dst = out.reserve(3 * 12);
+        if (format == PLY_BINARY) {
+            *dst++ = 3;
+            for (int c = 0; c < 3; ++c)
+                dst = put_le32(dst, corner[c]);
+        } else {
+            *dst++ = '3';
+            for (int c = 0; c < 3; ++c) {
+                *dst++ = ' ';
+                dst = put_ascii(dst, (uint64_t)corner[c]);
+            }
+            *dst++ = '\n';
+        }
+        out.commit(dst);
+    }
+
+    out.flush();
+    if (std::ferror(file))
+        std::cerr << "Error: Failed while writing " << fileName << std::endl;
+    std::fclose(file);
+}
+
+void writePLY(const std::vector<float>& vertices, const std::vector<float>& normals, const std::string& fileName,
+              PLYFormat format) {
+    write_ply(vertices.data(), normals.data(), vertices.size() / 3, nullptr, vertices.size() / 9, fileName, format);
+}
+
+void writePLY(const std::vector<float>& vertices, const std::vector<float>& normals, const std::vector<uint32_t>& indices,
+              const std::string& fileName, PLYFormat format) {
+    write_ply(vertices.data(), normals.data(), vertices.size() / 3, indices.data(), indices.size() / 3, fileName, format);
+}
+
+PLYStreamWriter::PLYStreamWriter(const std::string& fileName)
+    : out(fileName.c_str(), std::ios::binary), fileName(fileName), triangles(0) {
+    if (!out.is_open()) {
+        std::cerr << "Error: Unable to open file " << fileName << " for writing." << std::endl;
+        return;
+    }
+    std::string zeros(PLY_COUNT_DIGITS, '0');
+    out << "ply\n";
+    out << "format binary_little_endian 1.0\n";
+    out << "element vertex ";
+    vertexCountPos = out.tellp();
+    out << zeros << "\n";
+    out << "property float x\n";
+    out << "property float y\n";
+    out << "property float z\n";
+    out << "property float nx\n";
+    out << "property float ny\n";
+    out << "property float nz\n";
+    out << "element face ";
+    faceCountPos = out.tellp();
+    out << zeros << "\n";
+    out << "property list uchar int vertex_indices\n";
+    out << "end_header\n";
+}
+
+PLYStreamWriter::~PLYStreamWriter() {
+    close();
+}
+
+void PLYStreamWriter::append(const float* positions, size_t count) {
+    if (!out.is_open() || count == 0)
+        return;
+    normals.resize(count * 9);
+    compute_normals(positions, count, normals.data());
+
+    // x, y, z, nx, ny, nz per vertex
+    buffer.resize(count * 3 * 6 * 4);
+    char* dst = buffer.data();
+    for (size_t i = 0; i < count * 9; i += 3) {
+        dst = put_float(dst, positions[i]);
+        dst = put_float(dst, positions[i + 1]);
+        dst = put_float(dst, positions[i + 2]);
+        dst = put_float(dst, normals[i]);
+        dst = put_float(dst, normals[i + 1]);
+        dst = put_float(dst, normals[i + 2]);
+    }
+    out.write(buffer.data(), buffer.size());
+    triangles += count;
+}
+
+void PLYStreamWriter::close() {
+    if (!out.is_open())
+        return;
+
+    // Face t uses the three vertices appended with it; written in chunks so the
+    // face list does not need to be held in memory either.
+    const size_t faceBytes = 1 + 3 * 4;
+    const size_t chunk = 1 << 16;
+    buffer.resize(chunk * faceBytes);
+    for (size_t t0 = 0; t0 < triangles; t0 += chunk) {
+        size_t t1 = std::min(triangles, t0 + chunk);
+        char* dst = buffer.data();
+        for (size_t t = t0; t < t1; ++t) {
+            *dst++ = 3;
+            dst = put_le32(dst, (uint32_t)(t * 3));
+            dst = put_le32(dst, (uint32_t)(t * 3 + 1));
+            dst = put_le32(dst, (uint32_t)(t * 3 + 2));
+        }
+        out.write(buffer.data(), dst - buffer.data());
+    }
+
+    char digits[32];
+    snprintf(digits, sizeof(digits), "%0*llu", PLY_COUNT_DIGITS, (unsigned long long)(triangles * 3));
+    out.seekp(vertexCountPos);
+    out.write(digits, PLY_COUNT_DIGITS);
+    snprintf(digits, sizeof(digits), "%0*llu", PLY_COUNT_DIGITS, (unsigned long long)triangles);
+    out.seekp(faceCountPos);
+    out.write(digits, PLY_COUNT_DIGITS);
+
+    if (!out)
+        std::cerr << "Error: Failed while writing " << fileName << std::endl;
+    out.close();
+    std::vector<float>().swap(normals);
+    std::vector<char>().swap(buffer);
 }
 
 // A very basic readPLY function (for starter purposes)
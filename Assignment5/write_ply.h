@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <string>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
 
 // A simple Vertex struct used for PLY file I/O.
 struct Vertex {
@@ -10,8 +13,52 @@ struct Vertex {
     float nx, ny, nz;
 };
 
+// PLY encodings writePLY can produce. ASCII prints 6 significant digits per
+// float; binary little-endian stores them exactly and is about a third the size.
+enum PLYFormat {
+    PLY_ASCII,
+    PLY_BINARY
+};
+
 // Write the vertices and normals to a PLY file.
-void writePLY(const std::vector<float>& vertices, const std::vector<float>& normals, const std::string& fileName);
+void writePLY(const std::vector<float>& vertices, const std::vector<float>& normals, const std::string& fileName,
+              PLYFormat format = PLY_ASCII);
+
+// Write an indexed mesh (shared vertices) to a PLY file. vertices and normals
+// hold 3 floats per vertex; every 3 indices form one face. Both writers format
+// into one buffer that goes out with large fwrite calls.
+void writePLY(const std::vector<float>& vertices, const std::vector<float>& normals, const std::vector<uint32_t>& indices,
+              const std::string& fileName, PLYFormat format = PLY_ASCII);
+
+// Writes a flat triangle soup to a binary little-endian PLY file as it is
+// produced, so the whole mesh never has to be in memory (pass append to
+// marching_cubes_stream). Each triangle gets three vertices carrying its face
+// normal. The vertex and face counts are only known at the end: the header
+// reserves room for them and close() fills them in after writing the faces.
+class PLYStreamWriter {
+public:
+    explicit PLYStreamWriter(const std::string& fileName);
+    ~PLYStreamWriter();
+
+    bool isOpen() const { return out.is_open(); }
+    size_t triangleCount() const { return triangles; }
+
+    // Appends count triangles, 9 floats each.
+    void append(const float* positions, size_t count);
+    // Writes the face list and the final counts. Called by the destructor if needed.
+    void close();
+
+private:
+    PLYStreamWriter(const PLYStreamWriter&);
+    PLYStreamWriter& operator=(const PLYStreamWriter&);
+
+    std::ofstream out;
+    std::string fileName;
+    std::streampos vertexCountPos, faceCountPos;
+    size_t triangles;
+    std::vector<float> normals;
+    std::vector<char> buffer;
+};
 
 // Optionally, a function to read a PLY file (if needed)
 void readPLY(const std::string& filename, std::vector<Vertex>& vertices, std::vector<int>& indices);
@@ -128,11 +128,22 @@ int main( int argc, char* argv[])
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
 
+	bool packKeyWasDown = false;
+
 	do{
 		// Clear the screen
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		cameraFirstPerson(window, V, 5.0f);
 
+		// N (once per press) switches the plane between float and octahedral normals
+		bool packKey = glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS;
+		if (packKey && !packKeyWasDown) {
+			plane.setPackedNormals(!plane.hasPackedNormals());
+			std::cout << (plane.hasPackedNormals() ? "Octahedral normals, 4" : "Float normals, 12")
+			          << " bytes per normal" << std::endl;
+		}
+		packKeyWasDown = packKey;
+
 		plane.draw(lightpos, V, Projection);
 
 		// boat.draw(lightpos, V, Projection);
@@ -4,10 +4,12 @@
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>
+#include "octahedral.h" // Assignment5's encoder, built in by the Makefile
 
 PlaneMesh::PlaneMesh(float min, float max, float stepsize) {
     this->min = min;
     this->max = max;
+    packedNormals = false;
     modelColor = glm::vec4(0, 1.0f, 1.0f, 1.0f);
 
     planeMeshQuads(min, max, stepsize);
@@ -66,12 +68,8 @@ PlaneMesh::PlaneMesh(float min, float max, float stepsize) {
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-    // Normals
+    // Normals, as float triples until setPackedNormals(true); filled below
     glGenBuffers(1, &vboNormals);
-    glBindBuffer(GL_ARRAY_BUFFER, vboNormals);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
     glGenBuffers(1, &vboTexCoords);
     glBindBuffer(GL_ARRAY_BUFFER, vboTexCoords);
@@ -85,6 +83,7 @@ PlaneMesh::PlaneMesh(float min, float max, float stepsize) {
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_STATIC_DRAW);
 
     glBindVertexArray(0);
+    uploadNormals();
 }
 
 void PlaneMesh::planeMeshQuads(float min, float max, float stepsize) {
@@ -135,6 +134,33 @@ void PlaneMesh::planeMeshQuads(float min, float max, float stepsize) {
     }
 }
 
+// Fills the normal VBO in the current layout and points attribute 1 at it:
+// 3 floats per vertex, or 2 octahedral snorm16 values (4 bytes instead of 12).
+void PlaneMesh::uploadNormals() {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vboNormals);
+    if (packedNormals) {
+        std::vector<int16_t> packed(numVerts * 2);
+        for (int i = 0; i < numVerts; ++i)
+            octahedral_encode(&normals[i * 3], &packed[i * 2]);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(int16_t), packed.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, 0, (void*)0);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    }
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PlaneMesh::setPackedNormals(bool packed) {
+    if (packed == packedNormals)
+        return;
+    packedNormals = packed;
+    uploadNormals();
+}
+
 void PlaneMesh::draw(glm::vec3 lightPos, glm::mat4 V, glm::mat4 P) {
     glUseProgram(shaderProgram);
 
@@ -152,6 +178,7 @@ void PlaneMesh::draw(glm::vec3 lightPos, glm::mat4 V, glm::mat4 P) {
 
     glUniform1f(glGetUniformLocation(shaderProgram, "time"), (float)glfwGetTime()); 
     glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
+    glUniform1i(glGetUniformLocation(shaderProgram, "packedNormals"), packedNormals);
 
     glm::vec3 eyePos = glm::vec3(glm::inverse(V)[3]); // Extract camera position from view matrix
     glUniform3fv(glGetUniformLocation(shaderProgram, "eyePos"), 1, glm::value_ptr(eyePos));
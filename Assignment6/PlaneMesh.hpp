@@ -2,6 +2,7 @@
 #define PLANEMESH_HPP
 
 #include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 
@@ -9,10 +10,14 @@ class PlaneMesh {
 public:
     PlaneMesh(float min, float max, float stepsize);
     void draw(glm::vec3 lightPos, glm::mat4 V, glm::mat4 P);
+    // Switches the normal buffer between float triples and octahedral snorm16 pairs
+    void setPackedNormals(bool packed);
+    bool hasPackedNormals() const { return packedNormals; }
     void loadARGB_BMP(const char* imagepath, unsigned char** data, unsigned int* width, unsigned int* height, unsigned short* bpp);
 
 private:
     void planeMeshQuads(float min, float max, float stepsize);
+    void uploadNormals();
 
     std::vector<float> verts;
     std::vector<float> normals;
@@ -27,6 +32,7 @@ private:
     GLuint vboTexCoords;
 
     int numVerts, numIndices;
+    bool packedNormals;
     float min, max;
     glm::vec4 modelColor;
 };